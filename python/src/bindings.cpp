@@ -26,8 +26,14 @@
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
 
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
 #include <purple/problem.hpp>
 #include <purple/solver.hpp>
+#include <purple/macros.hpp>
 
 namespace logic = purple::logic;
 namespace temporal = purple::temporal;
@@ -99,6 +105,98 @@ namespace pypurple {
     throw py::type_error("Expected formula<FO>, given formula<LTLPFO>");
   }
 
+  //
+  // Bulk construction of facts from a table of object indexes, given as a 
+  // 2-D buffer of integers (e.g. a numpy array) or as a list of lists, whose
+  // rows are the arguments of each fact.
+  //
+  template<typename T>
+  static size_t 
+  element(py::buffer_info const& info, py::ssize_t i, py::ssize_t j) {
+    char const *ptr = static_cast<char const *>(info.ptr) + 
+      i * info.strides[0] + j * info.strides[1];
+
+    T value;
+    std::memcpy(&value, ptr, sizeof(T));
+    if constexpr(std::is_signed_v<T>) {
+      if(value < 0)
+        throw py::index_error("Negative object index in facts table");
+    }
+    return static_cast<size_t>(value);
+  }
+
+  using element_t = 
+    size_t (*)(py::buffer_info const&, py::ssize_t, py::ssize_t);
+
+  static element_t element_reader(py::buffer_info const& info) {
+    std::string format = info.format;
+    if(!format.empty() && std::string_view{"@=<>!"}.find(format[0]) != 
+        std::string_view::npos)
+      format.erase(0, 1);
+    
+    if(format.size() != 1)
+      throw py::type_error("Expected a table of integers");
+
+    bool is_signed = std::string_view{"bhilq"}.find(format[0]) != 
+      std::string_view::npos;
+    bool is_unsigned = std::string_view{"BHILQ"}.find(format[0]) != 
+      std::string_view::npos;
+    if(!is_signed && !is_unsigned)
+      throw py::type_error("Expected a table of integers");
+
+    switch(info.itemsize) {
+      case 1: return is_signed ? element<int8_t> : element<uint8_t>;
+      case 2: return is_signed ? element<int16_t> : element<uint16_t>;
+      case 4: return is_signed ? element<int32_t> : element<uint32_t>;
+      case 8: return is_signed ? element<int64_t> : element<uint64_t>;
+    }
+    throw py::type_error("Unsupported integer size in facts table");
+  }
+
+  static void add_facts(
+    purple::state &s, logic::relation rel, 
+    std::vector<logic::variable> const& objects, py::buffer table
+  ) {
+    py::buffer_info info = table.request();
+    if(info.ndim != 2)
+      throw py::type_error("Expected a 2-dimensional table of facts");
+    
+    element_t read = element_reader(info);
+
+    std::vector<logic::variable> args;
+    s.predicates.reserve(
+      s.predicates.size() + static_cast<size_t>(info.shape[0])
+    );
+    for(py::ssize_t i = 0; i < info.shape[0]; ++i) {
+      args.clear();
+      for(py::ssize_t j = 0; j < info.shape[1]; ++j) {
+        size_t index = read(info, i, j);
+        if(index >= objects.size())
+          throw py::index_error("Object index out of range in facts table");
+        args.push_back(objects[index]);
+      }
+      s.predicates.push_back(rel(args));
+    }
+  }
+
+  static void add_facts(
+    purple::state &s, logic::relation rel, 
+    std::vector<logic::variable> const& objects, 
+    std::vector<std::vector<size_t>> const& table
+  ) {
+    std::vector<logic::variable> args;
+    s.predicates.reserve(s.predicates.size() + table.size());
+    for(auto const& row : table) {
+      args.clear();
+      for(size_t index : row) {
+        if(index >= objects.size())
+          throw py::index_error("Object index out of range in facts table");
+        args.push_back(objects[index]);
+      }
+      s.predicates.push_back(rel(args));
+    }
+  }
+
 }
 
 PYBIND11_MODULE(purple_plan, m) {
@@ -162,21 +260,65 @@ PYBIND11_MODULE(purple_plan, m) {
   state.def_readwrite("fluents", &purple::state::fluents);
   state.def_readwrite("predicates", &purple::state::predicates);
 
+  state.def("add_facts", [](
+    purple::state &self, logic::relation rel, 
+    std::vector<logic::variable> const& objects, py::buffer table
+  ) {
+    add_facts(self, rel, objects, table);
+  }, py::arg("rel"), py::arg("objects"), py::arg("table"));
+
+  state.def("add_facts", [](
+    purple::state &self, logic::relation rel, 
+    std::vector<logic::variable> const& objects, 
+    std::vector<std::vector<size_t>> const& table
+  ) {
+    add_facts(self, rel, objects, table);
+  }, py::arg("rel"), py::arg("objects"), py::arg("table"));
+
+  m.def("objects", [](black::alphabet &sigma, std::vector<std::string> names) 
+  {
+    std::vector<logic::variable> result;
+    result.reserve(names.size());
+    for(std::string const& name : names)
+      result.push_back(sigma.variable(name));
+    return result;
+  }, py::arg("sigma"), py::arg("names"));
+
+  m.def("objects", [](black::alphabet &sigma, std::string prefix, size_t n) {
+    std::vector<logic::variable> result;
+    result.reserve(n);
+    for(size_t i = 0; i < n; ++i)
+      result.push_back(sigma.variable(prefix + std::to_string(i)));
+    return result;
+  }, py::arg("sigma"), py::arg("prefix"), py::arg("n"));
+
+  m.def("sort_decl", [](
+    black::alphabet &sigma, logic::named_sort sort, 
+    std::vector<logic::variable> const& objects
+  ) {
+    return sigma.sort_decl(sort, black::make_domain(objects));
+  }, py::arg("sigma"), py::arg("sort"), py::arg("objects"));
+
 
   py::class_<purple::action> action(m, "action");
   action.def(py::init([](
     black::identifier name,
     std::vector<black::var_decl> params,
     temporal::formula precondition,
-    std::vector<purple::effect> effects
+    std::vector<purple::effect> effects,
+    size_t cost
   ) {
-    return purple::action{name, params, to_fo(precondition), effects};
-  }));
+    return purple::action{name, params, to_fo(precondition), effects, cost};
+  }), 
+    py::arg("name"), py::arg("params"), py::arg("precondition"), 
+    py::arg("effects"), py::arg("cost") = 1
+  );
 
   action.def_readwrite("name", &purple::action::name);
   action.def_readwrite("params", &purple::action::params);
   action.def_readwrite("precondition", &purple::action::precondition);
   action.def_readonly("effects", &purple::action::effects);
+  action.def_readwrite("cost", &purple::action::cost);
 
   py::class_<purple::predicate> predicate(m, "predicate");
   predicate.def(py::init([](
@@ -207,21 +349,74 @@ PYBIND11_MODULE(purple_plan, m) {
   predicate.def_readwrite("name", &purple::predicate::name);
   predicate.def_readwrite("params", &purple::predicate::params);
 
+  py::class_<purple::derived_predicate> derived(m, "derived_predicate");
+  derived.def(py::init([](purple::predicate head, temporal::formula body){
+    return purple::derived_predicate{head, to_fo(body)};
+  }), py::arg("head"), py::arg("body"));
+  derived.def_readwrite("head", &purple::derived_predicate::head);
+  derived.def_readwrite("body", &purple::derived_predicate::body);
+
   py::class_<purple::domain> domain(m, "domain");
   domain.def(py::init([](
     black::alphabet *sigma,
     std::vector<logic::named_sort> types,
     std::vector<logic::proposition> fluents,
     std::vector<purple::predicate> predicates,
-    std::vector<purple::action> actions
+    std::vector<purple::action> actions,
+    std::vector<purple::derived_predicate> derived
   ){
-    return purple::domain{sigma, types, fluents, predicates, actions};
-  }));
+    return purple::domain{sigma, types, fluents, predicates, actions, derived};
+  }), 
+    py::arg("sigma"), py::arg("types"), py::arg("fluents"), 
+    py::arg("predicates"), py::arg("actions"), 
+    py::arg("derived") = std::vector<purple::derived_predicate>{}
+  );
 
   domain.def_readwrite("types", &purple::domain::types);
   domain.def_readwrite("fluents", &purple::domain::fluents);
   domain.def_readwrite("predicates", &purple::domain::predicates);
   domain.def_readwrite("actions", &purple::domain::actions);
+  domain.def_readwrite("derived", &purple::domain::derived);
+  domain.def_readonly("macros", &purple::domain::macros);
+
+  py::class_<purple::macro> macro(m, "macro");
+  macro.def_readonly("name", &purple::macro::name);
+  macro.def_readonly("steps", &purple::macro::steps);
+
+  py::class_<purple::macro::step> mstep(macro, "step");
+  mstep.def_readonly("action", &purple::macro::step::action);
+  mstep.def_readonly("args", &purple::macro::step::args);
+
+  m.def("learn_macros", &purple::learn_macros, 
+    py::arg("domain"), py::arg("plans"), py::arg("length") = 2, 
+    py::arg("support") = 2, py::arg("limit") = 8
+  );
+
+  py::class_<purple::constraint> constraint(m, "constraint");
+
+  py::enum_<purple::constraint::kind_t>(constraint, "kind")
+    .value("always", purple::constraint::always)
+    .value("sometime", purple::constraint::sometime)
+    .value("at_most_once", purple::constraint::at_most_once)
+    .value("sometime_before", purple::constraint::sometime_before)
+    .value("sometime_after", purple::constraint::sometime_after);
+
+  constraint.def(py::init([](
+    purple::constraint::kind_t kind, temporal::formula first
+  ){
+    return purple::constraint(kind, to_fo(first));
+  }), py::arg("kind"), py::arg("first"));
+
+  constraint.def(py::init([](
+    purple::constraint::kind_t kind, 
+    temporal::formula first, temporal::formula second
+  ){
+    return purple::constraint(kind, to_fo(first), to_fo(second));
+  }), py::arg("kind"), py::arg("first"), py::arg("second"));
+
+  constraint.def_readwrite("kind", &purple::constraint::kind);
+  constraint.def_readwrite("first", &purple::constraint::first);
+  constraint.def_readwrite("second", &purple::constraint::second);
 
   py::class_<purple::problem> problem(m, "problem");
   problem.def(py::init([](
@@ -229,15 +424,30 @@ PYBIND11_MODULE(purple_plan, m) {
     std::vector<black::sort_decl> types,
     purple::state init,
     temporal::formula goal,
-    temporal::formula trajectory
+    temporal::formula trajectory,
+    std::vector<purple::constraint> constraints
   ){
-    return purple::problem{sigma, types, init, to_fo(goal), trajectory};
-  }));
+    return purple::problem{
+      sigma, types, init, to_fo(goal), trajectory, constraints
+    };
+  }), 
+    py::arg("sigma"), py::arg("types"), py::arg("init"), py::arg("goal"),
+    py::arg("trajectory"), 
+    py::arg("constraints") = std::vector<purple::constraint>{}
+  );
   
   problem.def_readwrite("types", &purple::problem::types);
   problem.def_readwrite("init", &purple::problem::init);
   problem.def_readwrite("goal", &purple::problem::goal);
   problem.def_readwrite("trajectory", &purple::problem::trajectory);
+  problem.def_readwrite("constraints", &purple::problem::constraints);
+
+  py::class_<purple::query> query(m, "query");
+  query.def(py::init([](temporal::formula goal, temporal::formula trajectory){
+    return purple::query{to_fo(goal), trajectory};
+  }), py::arg("goal"), py::arg("trajectory"));
+  query.def_readwrite("goal", &purple::query::goal);
+  query.def_readwrite("trajectory", &purple::query::trajectory);
 
   py::class_<purple::plan::step> step(m, "step");
   step.def(py::init([](
@@ -254,14 +464,98 @@ PYBIND11_MODULE(purple_plan, m) {
   }));
   plan.def_readonly("steps", &purple::plan::steps);
 
+  py::class_<purple::compact_plan::step> cstep(m, "compact_step");
+  cstep.def(py::init([](size_t a, std::vector<logic::variable> args){
+    return purple::compact_plan::step{a, args};
+  }));
+  cstep.def_readwrite("action", &purple::compact_plan::step::action);
+  cstep.def_readwrite("args", &purple::compact_plan::step::args);
+
+  py::class_<purple::compact_plan> cplan(m, "compact_plan");
+  cplan.def(py::init([](std::vector<purple::compact_plan::step> steps){
+    return purple::compact_plan{steps};
+  }));
+  cplan.def_readonly("steps", &purple::compact_plan::steps);
+
   py::class_<purple::solver> solver(m, "solver");
+
+  py::class_<purple::solver::statistics> statistics(solver, "statistics");
+  statistics.def_readonly("queries", &purple::solver::statistics::queries);
+  statistics.def_readonly(
+    "peak_memory", &purple::solver::statistics::peak_memory
+  );
+  statistics.def_readonly(
+    "resident_memory", &purple::solver::statistics::resident_memory
+  );
+  statistics.def_readonly(
+    "memory_growth", &purple::solver::statistics::memory_growth
+  );
+  statistics.def_readonly("encoded", &purple::solver::statistics::encoded);
+  statistics.def_readonly("reused", &purple::solver::statistics::reused);
+  statistics.def_readonly(
+    "symmetric", &purple::solver::statistics::symmetric
+  );
+
+  py::class_<purple::solver::answer> answer(solver, "answer");
+  answer.def_readonly("result", &purple::solver::answer::result);
+  answer.def_readonly("solution", &purple::solver::answer::solution);
+
   solver.def(py::init<>());
+  // the solver keeps pointers to the domain, used by `replan()`, and to the 
+  // problem, used by `solution`
   solver.def("solve", [](
     purple::solver &self, purple::domain const& d, purple::problem const& p)
   {
     return self.solve(d, p);
-  });
+  }, py::keep_alive<1, 2>(), py::keep_alive<1, 3>());
+  solver.def("solve_queries", [](
+    purple::solver &self, purple::domain const& d, purple::problem const& p,
+    std::vector<purple::query> const& queries
+  ) {
+    return self.solve(d, p, queries);
+  }, py::keep_alive<1, 2>(), py::keep_alive<1, 3>());
+  solver.def("solve_batch", [](
+    purple::solver &self, purple::domain const& d, 
+    std::vector<purple::problem> const& problems
+  ) {
+    return self.solve(d, problems);
+  }, py::keep_alive<1, 2>());
+  solver.def(
+    "optimize", &purple::solver::optimize, 
+    py::keep_alive<1, 2>(), py::keep_alive<1, 3>()
+  );
+  solver.def("replan", [](purple::solver &self, purple::problem const& p) {
+    return self.replan(p);
+  }, py::keep_alive<1, 2>());
+  solver.def_property(
+    "split_arity", 
+    &purple::solver::split_arity, &purple::solver::set_split_arity
+  );
   solver.def_property_readonly("solution", &purple::solver::solution);
+  solver.def_property_readonly(
+    "compact_solution", &purple::solver::compact_solution
+  );
+  solver.def("for_each_step", &purple::solver::for_each_step);
+  solver.def_property_readonly("stats", &purple::solver::stats);
+  // sets the deadline of `solver::set_deadline()` to `seconds` from now, not 
+  // from the start of each call, so it covers all the calls made until then.
+  // `None` removes it.
+  solver.def("set_timeout", [](
+    purple::solver &self, std::optional<double> seconds
+  ) {
+    if(!seconds) {
+      self.set_deadline(std::nullopt);
+      return;
+    }
+
+    self.set_deadline(
+      purple::solver::clock::now() + 
+      std::chrono::duration_cast<purple::solver::clock::duration>(
+        std::chrono::duration<double>(*seconds)
+      )
+    );
+  });
+  solver.def("clear", &purple::solver::clear);
 
 }
 
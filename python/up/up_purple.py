@@ -21,6 +21,7 @@
 # OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 
+import time
 import typing
 import warnings
 import unified_planning as up
@@ -119,10 +120,30 @@ class PurpleEngineImpl(
     ):
     """ Implementation of the up-purple Engine. """
 
+    # Conversions are kept across calls, so that problems over the same 
+    # domain, or sharing expressions, are converted only once. They are all
+    # dropped, together with the alphabet that interns the converted 
+    # formulas, once more than `max_domains` domains or `max_expressions` 
+    # expressions have been converted.
+    max_domains = 32
+    max_expressions = 1 << 20
+
     def __init__(self, weight = None, heuristic = None, **options):
         up.engines.Engine.__init__(self)
         up.engines.mixins.OneshotPlannerMixin.__init__(self)
+        self._reset_caches()
+
+    def _reset_caches(self):
         self._sigma = black.alphabet()
+        self._converter = FormulasConverter(self._sigma)
+        self._domains = {}
+        self._converted_actions = {}
+
+    # called before each conversion, never while one is in progress
+    def _trim_caches(self):
+        if len(self._domains) > self.max_domains or \
+           len(self._converter.memoization) > self.max_expressions:
+            self._reset_caches()
 
     @property
     def name(self):
@@ -157,28 +178,61 @@ class PurpleEngineImpl(
 
     def _solve(self, problem, heuristic = None, timeout = None, os = None):
         assert isinstance(problem, up.model.Problem)
-        if timeout is not None:
-            warnings.warn('PURPLE does not support timeout.', UserWarning)
         if os is not None:
             warnings.warn('PURPLE does not support output stream.', UserWarning)
         if heuristic is not None:
             warnings.warn('PURPLE does not support heuristics', UserWarning)
         
-        self._expr_manager = problem.environment.expression_manager
-        self._objects = {}
-        self._actions = {}
+        # the timeout covers the conversion as well, since `set_timeout()` 
+        # fixes the deadline when it is called
+        slv = purple.solver()
+        slv.set_timeout(timeout)
+        start = time.monotonic()
+        self._trim_caches()
 
         # 1. convert problem to PURPLE
         domain, instance = self._convert_problem(problem)
         
         # 2. call solver
-        slv = purple.solver()
         result = slv.solve(domain, instance)
         
+        # 3. convert plan to UP
+        plan = None
+        if result == True:
+            solution = slv.compact_solution
+            assert solution
+            plan = self._convert_plan(problem, solution)
+        
+        timed_out = timeout is not None and time.monotonic() - start >= timeout
+        return self._convert_result(result, plan, timed_out)
+
+    def solve_batch(self, problems):
+        """Solves each of the given problems, with a single call to PURPLE 
+        for all the problems over the same domain, which is converted and 
+        encoded only once. Returns the results in the order of `problems`."""
+        self._trim_caches()
+        groups = {}
+        for i, problem in enumerate(problems):
+            assert isinstance(problem, up.model.Problem)
+            groups.setdefault(self._domain_key(problem), []).append(i)
+
+        results = [None] * len(problems)
+        for indexes in groups.values():
+            domain = self._convert_domain(problems[indexes[0]])
+            instances = [self._convert_instance(problems[i]) for i in indexes]
+            
+            answers = purple.solver().solve_batch(domain, instances)
+            
+            for i, answer in zip(indexes, answers):
+                plan = None
+                if answer.result == True:
+                    plan = self._convert_plan(problems[i], answer.solution)
+                results[i] = self._convert_result(answer.result, plan)
+
+        return results
+
+    def _convert_result(self, result, plan, timed_out = False):
         if result == True:
-            # 3. convert plan to UP
-            assert slv.solution
-            plan = self._convert_plan(slv.solution)
             return up.engines.PlanGenerationResult(
                 up.engines.PlanGenerationResultStatus.SOLVED_SATISFICING, 
                 plan, self.name
@@ -187,14 +241,17 @@ class PurpleEngineImpl(
             return up.engines.PlanGenerationResult(
                 up.engines.PlanGenerationResultStatus.UNSOLVABLE_PROVEN
             )
+        elif timed_out:
+            return up.engines.PlanGenerationResult(
+                up.engines.PlanGenerationResultStatus.TIMEOUT, None, self.name
+            )
         else:
             return up.engines.PlanGenerationResult(
                 up.engines.PlanGenerationResultStatus.UNSOLVABLE_INCOMPLETELY
             )
     
     def _convert_expr(self, expr):
-        converter = FormulasConverter(self._sigma)
-        return converter.convert(expr)
+        return self._converter.convert(expr)
 
     def _convert_type(self, type_):
         if type_.is_bool_type():
@@ -209,11 +266,9 @@ class PurpleEngineImpl(
             raise NotImplemented
         
         sort = self._convert_type(type_)
-        elements = []
-        for o in problem.objects(type_):
-            e = self._sigma.variable(o.name)
-            elements.append(e)
-            self._objects[o.name] = o
+        elements = [
+            self._sigma.variable(o.name) for o in problem.objects(type_)
+        ]
 
         return self._sigma.sort_decl(sort, black.domain(elements))
 
@@ -250,6 +305,9 @@ class PurpleEngineImpl(
         return purple.effect(condition, fluents, predicates, pos)
 
     def _convert_action(self, action):
+        if action in self._converted_actions:
+            return self._converted_actions[action]
+
         name = action.name
         params = [self._convert_param(p) for p in action.parameters]
         precondition = black.big_and(
@@ -258,7 +316,7 @@ class PurpleEngineImpl(
         effects = [self._convert_effect(e) for e in action.effects]
 
         a = purple.action(name, params, precondition, effects)
-        self._actions[name] = action
+        self._converted_actions[action] = a
         return a
 
     def _convert_init(self, problem):
@@ -273,14 +331,44 @@ class PurpleEngineImpl(
                     predicates.append(self._convert_expr(fluent))
         return purple.state(fluents, predicates)
 
-    def _convert_trajectory(self, problem):
-        converted = [
-            self._convert_expr(e) for e in problem.trajectory_constraints
+    def _convert_constraint(self, expr):
+        kinds = [
+            (expr.is_always, purple.constraint.kind.always),
+            (expr.is_sometime, purple.constraint.kind.sometime),
+            (expr.is_at_most_once, purple.constraint.kind.at_most_once),
+            (expr.is_sometime_before, purple.constraint.kind.sometime_before),
+            (expr.is_sometime_after, purple.constraint.kind.sometime_after)
         ]
-        return black.big_and(self._sigma, converted)
+        for is_kind, kind in kinds:
+            if is_kind():
+                args = [self._convert_expr(a) for a in expr.args]
+                return purple.constraint(kind, *args)
+        return None
 
+    def _convert_trajectory(self, problem):
+        converted = []
+        constraints = []
+        for e in problem.trajectory_constraints:
+            c = self._convert_constraint(e)
+            if c is not None:
+                constraints.append(c)
+            else:
+                converted.append(self._convert_expr(e))
+        return (black.big_and(self._sigma, converted), constraints)
+
+
+    def _domain_key(self, problem):
+        return (
+            tuple(problem.user_types), 
+            tuple(problem.fluents), 
+            tuple(problem.actions)
+        )
+
+    def _convert_domain(self, problem):
+        key = self._domain_key(problem)
+        if key in self._domains:
+            return self._domains[key]
 
-    def _convert_problem(self, problem):
         types = [self._convert_type(t) for t in problem.user_types]
         fluents = [
             self._convert_fluent(f) for f in problem.fluents if f.arity == 0
@@ -292,7 +380,10 @@ class PurpleEngineImpl(
         actions = [self._convert_action(a) for a in problem.actions]
 
         domain = purple.domain(self._sigma, types, fluents, predicates, actions)
+        self._domains[key] = domain
+        return domain
 
+    def _convert_instance(self, problem):
         type_decls = [
             self._convert_type_decl(problem, t) for t in problem.user_types
         ]
@@ -300,22 +391,32 @@ class PurpleEngineImpl(
         goal = black.big_and(
             self._sigma, [self._convert_expr(e) for e in problem.goals]
         )
-        trajectory = self._convert_trajectory(problem)
+        trajectory, constraints = self._convert_trajectory(problem)
 
-        instance = \
-            purple.problem(self._sigma, type_decls, init, goal, trajectory)
+        return purple.problem(
+            self._sigma, type_decls, init, goal, trajectory, constraints
+        )
 
-        return (domain, instance)
+    def _convert_problem(self, problem):
+        return (self._convert_domain(problem), self._convert_instance(problem))
 
-    def _convert_back_variable(self, var):
-        return self._expr_manager.ObjectExp(self._objects[str(var.name)])
+    def _convert_back_variable(self, problem, var):
+        manager = problem.environment.expression_manager
+        return manager.ObjectExp(problem.object(str(var.name)))
 
-    def _convert_plan(self, plan):
+    # `plan` is either a compact plan, whose steps refer to actions by index, 
+    # or a plan whose steps carry the converted actions
+    def _convert_plan(self, problem, plan):
         actions = []
         for step in plan.steps:
-            action = self._actions[str(step.action.name)]
+            if isinstance(step.action, purple.action):
+                action = problem.action(str(step.action.name))
+            else:
+                action = problem.actions[step.action]
             assert action is not None
-            params = tuple([self._convert_back_variable(v) for v in step.args])
+            params = tuple(
+                [self._convert_back_variable(problem, v) for v in step.args]
+            )
             actions.append(up.plans.ActionInstance(action, params))
         
         return up.plans.SequentialPlan(actions)
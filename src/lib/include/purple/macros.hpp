@@ -0,0 +1,50 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PURPLE_MACROS_HPP
+#define PURPLE_MACROS_HPP
+
+#include <purple/problem.hpp>
+
+#include <vector>
+
+namespace purple {
+
+  //
+  // Mines the sequences of `length` consecutive steps occurring at least 
+  // `support` times in `plans`, with the same actions and the same pattern
+  // of shared arguments, and adds to `d` a macro for each of the `limit` 
+  // most frequent ones. Returns the number of macros added, which is zero if
+  // the derived predicates of `d` are recursive. Solutions found with them 
+  // are expanded back into the primitive steps, but the states in between 
+  // are skipped, so they are not suitable for problems with trajectories or
+  // constraints. Macros take effect on the next call to `solver::solve()`.
+  //
+  size_t learn_macros(
+    domain &d, std::vector<compact_plan> const& plans, 
+    size_t length = 2, size_t support = 2, size_t limit = 8
+  );
+
+}
+
+#endif // PURPLE_MACROS_HPP
@@ -28,6 +28,7 @@
 #include <black/support/tribool.hpp>
 
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
 
 namespace purple {
@@ -99,6 +100,7 @@ namespace purple {
 
     logic::formula precondition;
     std::vector<effect> effects;
+    size_t cost = 1;
   };
 
   // schematic fluent (a.k.a. predicate)
@@ -120,6 +122,25 @@ namespace purple {
     }
   };
 
+  // derived predicate (a.k.a. PDDL axiom), which in each state holds exactly
+  // for the arguments satisfying `body`. Bodies may mention other derived 
+  // predicates, but not recursively.
+  struct derived_predicate {
+    predicate head;
+    logic::formula body;
+  };
+
+  // action of the domain that executes a sequence of other actions at once
+  struct macro {
+    struct step {
+      size_t action;            // index into `domain::actions`
+      std::vector<size_t> args; // indexes into the params of the macro
+    };
+
+    identifier name;            // name of the macro in `domain::actions`
+    std::vector<step> steps;
+  };
+
   // planning domain
   struct domain {
     black::alphabet *sigma;
@@ -127,6 +148,29 @@ namespace purple {
     std::vector<logic::proposition> fluents;
     std::vector<predicate> predicates;
     std::vector<action> actions;
+    std::vector<derived_predicate> derived = {};
+    std::vector<macro> macros = {};
+  };
+
+  // PDDL3 trajectory constraint, compiled into a monitor fluent
+  struct constraint {
+    enum kind_t : uint8_t {
+      always,          // `first` holds in every state
+      sometime,        // `first` holds in some state
+      at_most_once,    // `first` holds in at most one interval of states
+      sometime_before, // if `first` holds, `second` held strictly before
+      sometime_after   // if `first` holds, `second` holds now or later
+    };
+
+    kind_t kind;
+    logic::formula first;
+    logic::formula second;
+
+    constraint(kind_t k, logic::formula f)
+      : kind{k}, first{f}, second{f.sigma()->top()} { }
+
+    constraint(kind_t k, logic::formula f, logic::formula s)
+      : kind{k}, first{f}, second{s} { }
   };
 
   // planning problem
@@ -136,6 +180,13 @@ namespace purple {
     state init;
     logic::formula goal;
     temporal::formula trajectory;
+    std::vector<constraint> constraints = {};
+  };
+
+  // goal and trajectory to achieve from the initial state of a problem
+  struct query {
+    logic::formula goal;
+    temporal::formula trajectory;
   };
 
   struct plan {
@@ -147,6 +198,16 @@ namespace purple {
     std::vector<step> steps;
   };
 
+  // plan whose steps refer to actions by index into `domain::actions`
+  struct compact_plan {
+    struct step {
+      size_t action;
+      std::vector<logic::variable> args;
+    };
+
+    std::vector<step> steps;
+  };
+
 }
 
 #endif // PURPLE_PROBLEM_HPP
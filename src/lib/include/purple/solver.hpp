@@ -28,19 +28,129 @@
 
 #include <black/solver/solver.hpp>
 
+#include <optional>
+#include <functional>
+#include <chrono>
+#include <memory>
+
 namespace purple {
+
+  class encoder;
+
   class solver {
   public:
+    solver();
+    ~solver();
+
+    // solvers can be moved but not copied, since they own their encoding
+    solver(solver&&);
+    solver &operator=(solver&&);
+    using clock = std::chrono::steady_clock;
+
+    // resources used by the last call to `solve()` or `replan()`. Memory is
+    // measured for the whole process, in bytes, so it includes whatever other
+    // threads allocate meanwhile. `peak_memory` is the high-water mark of the
+    // process so far, not of the call: it does not change across calls that
+    // need less memory than an earlier one.
+    struct statistics {
+      size_t queries = 0;         // ground atoms built to read the solution
+      size_t peak_memory = 0;     // peak resident memory of the process
+      size_t resident_memory = 0; // resident memory at the end of the call
+      size_t memory_growth = 0;   // growth of `resident_memory` during the call
+      size_t encoded = 0;         // shared subformulas built by the encoder
+      size_t reused = 0;          // uses of them served from its memo cache,
+                                  // which would have been built again
+      size_t symmetric = 0;       // objects ruled out by symmetry breaking
+                                  // as the first choice of their class,
+                                  // in the last encoding
+    };
+
+    // outcome of a query, with its plan if `result == true`
+    struct answer {
+      tribool result = tribool::undef;
+      std::optional<plan> solution;
+    };
+
     tribool solve(domain const& d, problem const& p);
 
+    // answers each of `queries` from the initial state of `p`, whose own goal
+    // and trajectory are ignored. The queries share the same encoding, and 
+    // each call to BLACK looks for a plan for any of those not answered yet,
+    // so that all the unreachable ones are answered by a single call.
+    std::vector<answer> 
+    solve(domain const& d, problem const& p, std::vector<query> const& queries);
+
+    // anytime search: finds a first plan as `solve()` does, then looks for
+    // plans of strictly lower total `action::cost` until there are none or
+    // the deadline has passed, calling `f` with each plan found and its cost.
+    // Returns `true` if the last plan is optimal, `false` if there are no 
+    // plans and `tribool::undef` if the deadline has passed.
+    tribool optimize(
+      domain const& d, problem const& p, 
+      std::function<void(plan const&, size_t)> f
+    );
+
+    // solves each of `problems`, which must be over `d`, encoding the domain
+    // only once. Solutions are only available in the returned answers.
+    std::vector<answer> 
+    solve(domain const& d, std::vector<problem> const& problems);
+
+    // solves `p` over the domain of the last call to `solve()`, reusing its
+    // transition encoding, so that only `types`, `init`, `goal` and 
+    // `trajectory` are encoded again. `p` must be a problem over that domain,
+    // which must still be alive. Returns `tribool::undef` if actions have 
+    // been added, removed or renamed since, but changes to the body of an 
+    // action are not detected and require a new call to `solve()`.
+    tribool replan(problem const& p);
+
+    // actions with at least `k` parameters (if `k > 0`) are encoded by 
+    // choosing each argument independently, instead of with a relation over
+    // all of them. Takes effect on the next call to `solve()`. The default 
+    // of 3 already factors actions with three or more parameters, which 
+    // changes the encoding used before this option existed; set it to 0 to 
+    // encode every action with a single relation as before.
+    void set_split_arity(size_t k) { _split_arity = k; }
+    size_t split_arity() const { return _split_arity; }
+
+    // calls to `solve()` and `replan()` give up and return `tribool::undef`
+    // once the deadline has passed. It is checked each time a new bound of 
+    // the unrolling is reached.
+    void set_deadline(std::optional<clock::time_point> deadline) { 
+      _deadline = deadline; 
+    }
+    std::optional<clock::time_point> deadline() const { return _deadline; }
+
     std::optional<plan> solution() const;
+    std::optional<compact_plan> compact_solution() const;
+
+    // calls `f` on each step of the solution, in order, as soon as it is 
+    // extracted from the model, expanding macros into the steps they stand
+    // for. Returns `false` if there is no solution.
+    bool for_each_step(std::function<void(compact_plan::step)> f) const;
+
+    statistics const& stats() const { return _stats; }
+
+    // releases the memory held by the underlying solver for the last call to
+    // `solve()` or `replan()`, including the solution. The domain encoding is
+    // kept for later calls to `replan()`.
+    void clear();
   private:
     domain const*_d = nullptr;
     problem const*_p = nullptr;
+    std::unique_ptr<encoder> _encoder;
+    std::optional<temporal::formula> _transition;
+    size_t _split_arity = 3;
+    std::optional<clock::time_point> _deadline;
+    mutable statistics _stats;
 
     black::solver _slv;
 
-    std::optional<plan::step> get_step(size_t t) const;
+    void prepare(domain const& d);
+    tribool run(
+      problem const& p, std::vector<query> const& queries, 
+      std::optional<size_t> bound = {}
+    );
+    std::optional<compact_plan::step> get_step(size_t t) const;
   };
 }
 
@@ -0,0 +1,58 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PURPLE_COMMON_HPP
+#define PURPLE_COMMON_HPP
+
+//
+// Helpers shared by the encoding of the solver and the composition of 
+// macros. This header is internal to the library and is not installed.
+//
+
+#include <purple/problem.hpp>
+
+#include <vector>
+
+namespace purple {
+
+  inline logic::formula 
+  _exists(std::vector<logic::var_decl> const& params, logic::formula matrix) {
+    if(params.empty())
+      return matrix;
+    return black::logic::exists(params, matrix);
+  }
+
+  inline logic::formula logic_forall(
+    std::vector<logic::var_decl> const& params, logic::formula matrix
+  ) {
+    if(params.empty())
+      return matrix;
+    return black::logic::forall(params, matrix);
+  }
+
+  // tells whether the derived predicates do not depend on themselves
+  bool stratified(domain const& d);
+
+}
+
+#endif // PURPLE_COMMON_HPP
@@ -0,0 +1,441 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <purple/macros.hpp>
+
+#include "common.hpp"
+
+#include <algorithm>
+#include <array>
+#include <map>
+#include <optional>
+#include <string_view>
+
+namespace purple {
+
+  using namespace std::literals;
+
+  template<typename Terms1, typename Terms2>
+  static logic::formula 
+  equals(logic::alphabet *sigma, Terms1 const& ts, Terms2 const& us) {
+    std::vector<logic::formula> eqs;
+    for(size_t i = 0; i < ts.size(); ++i)
+      eqs.push_back(ts[i] == us[i]);
+    
+    return big_and(*sigma, eqs);
+  }
+
+  static bool is_macro(domain const& d, size_t a) {
+    for(macro const& m : d.macros)
+      if(m.name == d.actions[a].name)
+        return true;
+    return false;
+  }
+
+  //
+  // Builder of the action executing the steps of a macro at once. Each step
+  // is first instantiated over the params of the macro, and then the steps 
+  // are composed pairwise: the precondition and the effect conditions of the
+  // second action are regressed through the effects of the first one, whose
+  // effects are kept only where the second one does not override them.
+  //
+  class composer 
+  {
+  public:
+    composer(domain const& d, identifier name) 
+      : _d{d}, _sigma{d.sigma}, _name{name} { }
+
+    action compose(
+      std::vector<macro::step> const& steps, 
+      std::vector<logic::var_decl> const& params
+    );
+
+  private:
+    action instantiate(
+      macro::step const& s, std::vector<logic::var_decl> const& params
+    );
+    action sequence(action const& a, action const& b);
+    logic::formula regress(logic::formula f, action const& a);
+    logic::formula consistent(action const& a);
+    logic::formula overridden(
+      logic::proposition p, bool positive, action const& a, action const& b
+    );
+    logic::formula overridden(
+      logic::atom t, bool positive, action const& a, action const& b
+    );
+    logic::variable fresh();
+
+    domain const& _d;
+    logic::alphabet *_sigma;
+    identifier _name;
+    size_t _fresh = 0;
+  };
+
+  logic::variable composer::fresh() {
+    return _sigma->variable(std::tuple{"_fresh_"sv, _name, _fresh++});
+  }
+
+  action composer::compose(
+    std::vector<macro::step> const& steps, 
+    std::vector<logic::var_decl> const& params
+  ) {
+    black_assert(!steps.empty());
+
+    action result = instantiate(steps[0], params);
+    for(size_t k = 1; k < steps.size(); ++k)
+      result = sequence(result, instantiate(steps[k], params));
+    
+    result.name = _name;
+    return result;
+  }
+
+  // the action of `s` with its params replaced by those of the macro
+  action composer::instantiate(
+    macro::step const& s, std::vector<logic::var_decl> const& params
+  ) {
+    action const& a = _d.actions[s.action];
+
+    std::vector<logic::variable> args;
+    for(size_t slot : s.args)
+      args.push_back(params[slot].variable());
+    
+    auto guard = [&](logic::formula f) {
+      std::vector<logic::variable> vars;
+      for(logic::var_decl decl : a.params)
+        vars.push_back(decl.variable());
+      return logic_forall(a.params, implies(equals(_sigma, vars, args), f));
+    };
+
+    auto rename = [&](logic::atom t) {
+      std::vector<logic::term> terms;
+      for(logic::term term : t.terms()) {
+        if(auto v = term.to<logic::variable>(); v)
+          for(size_t i = 0; i < a.params.size(); ++i)
+            if(v->name() == a.params[i].variable().name())
+              term = args[i];
+        terms.push_back(term);
+      }
+      return t.rel()(terms);
+    };
+
+    std::vector<effect> effects;
+    for(effect const& e : a.effects) {
+      std::vector<logic::atom> predicates;
+      for(logic::atom t : e.predicates)
+        predicates.push_back(rename(t));
+      
+      effects.push_back(
+        effect{guard(e.precondition), e.fluents, predicates, e.positive}
+      );
+    }
+
+    return action{a.name, params, guard(a.precondition), effects, a.cost};
+  }
+
+  // the action executing `a` and then `b`, both over the params of the macro
+  action composer::sequence(action const& a, action const& b) {
+    std::vector<effect> effects;
+    
+    for(effect const& e : a.effects) {
+      for(logic::proposition p : e.fluents)
+        effects.push_back(effect{
+          e.precondition && !overridden(p, e.positive, a, b), p, e.positive
+        });
+      for(logic::atom t : e.predicates)
+        effects.push_back(effect{
+          e.precondition && !overridden(t, e.positive, a, b), t, e.positive
+        });
+    }
+
+    for(effect const& e : b.effects)
+      effects.push_back(effect{
+        regress(e.precondition, a), e.fluents, e.predicates, e.positive
+      });
+
+    logic::formula pre = 
+      a.precondition && consistent(a) && regress(b.precondition, a);
+
+    return action{_name, a.params, pre, effects, a.cost + b.cost};
+  }
+
+  // whether `b` sets the fluent `p` to the opposite of `positive`
+  logic::formula composer::overridden(
+    logic::proposition p, bool positive, action const& a, action const& b
+  ) {
+    std::vector<logic::formula> guards;
+    for(effect const& e : b.effects) {
+      if(e.positive == positive)
+        continue;
+      for(logic::proposition q : e.fluents)
+        if(q.name() == p.name())
+          guards.push_back(regress(e.precondition, a));
+    }
+
+    return big_or(*_sigma, guards);
+  }
+
+  // whether `b` sets the atom `t` to the opposite of `positive`
+  logic::formula composer::overridden(
+    logic::atom t, bool positive, action const& a, action const& b
+  ) {
+    std::vector<logic::formula> guards;
+    for(effect const& e : b.effects) {
+      if(e.positive == positive)
+        continue;
+      for(logic::atom u : e.predicates)
+        if(u.rel().name() == t.rel().name())
+          guards.push_back(
+            regress(e.precondition, a) && 
+            equals(_sigma, t.terms(), u.terms())
+          );
+    }
+
+    return big_or(*_sigma, guards);
+  }
+
+  // whether the effects of `a` do not contradict each other, which makes the
+  // action not executable by itself
+  logic::formula composer::consistent(action const& a) {
+    std::vector<logic::formula> axioms;
+    for(effect const& e1 : a.effects) {
+      if(!e1.positive)
+        continue;
+      for(effect const& e2 : a.effects) {
+        if(e2.positive)
+          continue;
+        
+        logic::formula both = e1.precondition && e2.precondition;
+        for(logic::proposition p : e1.fluents)
+          for(logic::proposition q : e2.fluents)
+            if(p.name() == q.name())
+              axioms.push_back(!both);
+        for(logic::atom t : e1.predicates)
+          for(logic::atom u : e2.predicates)
+            if(t.rel().name() == u.rel().name())
+              axioms.push_back(
+                !(both && equals(_sigma, t.terms(), u.terms()))
+              );
+      }
+    }
+
+    return big_and(*_sigma, axioms);
+  }
+
+  //
+  // Rewrites `f` into a formula that holds before `a` iff `f` holds after 
+  // it. Each fluent becomes `added || (fluent && !deleted)`, and derived 
+  // predicates are replaced by their definitions. Terms of atoms are only 
+  // compared with equalities outside of the quantifiers of the conditions 
+  // of `a`, which are closed over the params of the macro, so no variable 
+  // is captured.
+  //
+  logic::formula composer::regress(logic::formula f, action const& a) {
+    using namespace logic;
+
+    return f.match(
+      [&](boolean b) -> formula { return b; },
+      [&](proposition p) -> formula {
+        std::array<std::vector<formula>, 2> guards;
+        for(effect const& e : a.effects)
+          for(proposition q : e.fluents)
+            if(q.name() == p.name())
+              guards[e.positive].push_back(e.precondition);
+        
+        if(guards[true].empty() && guards[false].empty())
+          return p;
+        
+        return big_or(*_sigma, guards[true]) || 
+          (p && !big_or(*_sigma, guards[false]));
+      },
+      [&](atom t, auto rel, auto terms) -> formula {
+        for(derived_predicate const& der : _d.derived) {
+          if(der.head.name.name() != rel.name())
+            continue;
+
+          std::vector<var_decl> ws;
+          for(var_decl decl : der.head.params)
+            ws.push_back(_sigma->var_decl(fresh(), decl.sort()));
+          
+          std::vector<variable> wvars, pvars;
+          for(size_t i = 0; i < ws.size(); ++i) {
+            wvars.push_back(ws[i].variable());
+            pvars.push_back(der.head.params[i].variable());
+          }
+
+          return regress(
+            _exists(ws, equals(_sigma, wvars, terms) && 
+              _exists(der.head.params, 
+                equals(_sigma, pvars, wvars) && der.body
+              )
+            ), a
+          );
+        }
+
+        std::array<std::vector<formula>, 2> guards;
+        for(effect const& e : a.effects)
+          for(atom u : e.predicates)
+            if(u.rel().name() == rel.name())
+              guards[e.positive].push_back(
+                e.precondition && equals(_sigma, terms, u.terms())
+              );
+
+        if(guards[true].empty() && guards[false].empty())
+          return t;
+        
+        return big_or(*_sigma, guards[true]) || 
+          (t && !big_or(*_sigma, guards[false]));
+      },
+      [&](logic::exists, auto decls, auto matrix) -> formula {
+        return black::logic::exists(decls, regress(matrix, a));
+      },
+      [&](logic::forall, auto decls, auto matrix) -> formula {
+        return black::logic::forall(decls, regress(matrix, a));
+      },
+      [&](negation, auto arg) -> formula {
+        return !regress(arg, a);
+      },
+      [&](conjunction, auto left, auto right) -> formula {
+        return regress(left, a) && regress(right, a);
+      },
+      [&](disjunction, auto left, auto right) -> formula {
+        return regress(left, a) || regress(right, a);
+      },
+      [&](implication, auto left, auto right) -> formula {
+        return implies(regress(left, a), regress(right, a));
+      },
+      [&](logic::iff, auto left, auto right) -> formula {
+        return logic::iff(regress(left, a), regress(right, a));
+      },
+      [&](otherwise) -> formula { return f; } // equalities
+    );
+  }
+
+  //
+  // A pattern is a sequence of actions, together with the slot of the macro
+  // filled by each argument, in order of first occurrence of the objects. 
+  // It is flattened as the index of each action, followed by the number of
+  // its arguments and their slots.
+  //
+  using pattern = std::vector<size_t>;
+
+  static std::optional<pattern> pattern_of(
+    domain const& d, std::vector<compact_plan::step> const& steps, 
+    size_t begin, size_t length
+  ) {
+    pattern key;
+    std::vector<identifier> objects;
+    for(size_t k = begin; k < begin + length; ++k) {
+      if(is_macro(d, steps[k].action))
+        return {};
+
+      key.push_back(steps[k].action);
+      key.push_back(steps[k].args.size());
+      for(logic::variable x : steps[k].args) {
+        auto it = std::find(objects.begin(), objects.end(), x.name());
+        key.push_back(size_t(it - objects.begin()));
+        if(it == objects.end())
+          objects.push_back(x.name());
+      }
+    }
+
+    return key;
+  }
+
+  static std::vector<macro::step> steps_of(pattern const& key) {
+    std::vector<macro::step> steps;
+    for(size_t i = 0; i < key.size(); i += key[i + 1] + 2) {
+      auto args = key.begin() + ptrdiff_t(i) + 2;
+      steps.push_back(macro::step{
+        key[i], std::vector<size_t>(args, args + ptrdiff_t(key[i + 1]))
+      });
+    }
+    
+    return steps;
+  }
+
+  static pattern key_of(std::vector<macro::step> const& steps) {
+    pattern key;
+    for(macro::step const& s : steps) {
+      key.push_back(s.action);
+      key.push_back(s.args.size());
+      key.insert(key.end(), s.args.begin(), s.args.end());
+    }
+
+    return key;
+  }
+
+  size_t learn_macros(
+    domain &d, std::vector<compact_plan> const& plans, 
+    size_t length, size_t support, size_t limit
+  ) {
+    // derived predicates are unfolded when regressing conditions through 
+    // the steps, which would never end on a recursive definition
+    if(length < 2 || !stratified(d))
+      return 0;
+
+    std::map<pattern, size_t> counts;
+    for(compact_plan const& p : plans)
+      for(size_t i = 0; i + length <= p.steps.size(); ++i)
+        if(auto key = pattern_of(d, p.steps, i, length); key)
+          counts[*key]++;
+
+    for(macro const& m : d.macros)
+      counts.erase(key_of(m.steps));
+
+    std::vector<std::pair<size_t, pattern>> frequent;
+    for(auto const& [key, count] : counts)
+      if(count >= support)
+        frequent.push_back({count, key});
+    
+    std::stable_sort(frequent.begin(), frequent.end(), 
+      [](auto const& x, auto const& y) { return x.first > y.first; }
+    );
+    if(frequent.size() > limit)
+      frequent.resize(limit);
+
+    for(auto const& [count, key] : frequent) {
+      std::vector<macro::step> steps = steps_of(key);
+      identifier name{std::tuple{"_macro_"sv, d.macros.size()}};
+
+      // the sort of each slot is the one of the first param it fills
+      std::vector<logic::var_decl> params;
+      for(macro::step const& s : steps) {
+        for(size_t i = 0; i < s.args.size(); ++i) {
+          if(s.args[i] < params.size())
+            continue;
+          logic::variable y = 
+            d.sigma->variable(std::tuple{"_macro_"sv, name, s.args[i]});
+          params.push_back(d.sigma->var_decl(
+            y, d.actions[s.action].params[i].sort()
+          ));
+        }
+      }
+
+      d.actions.push_back(composer{d, name}.compose(steps, params));
+      d.macros.push_back(macro{name, steps});
+    }
+
+    return frequent.size();
+  }
+
+}
@@ -23,18 +23,83 @@
 
 #include <purple/solver.hpp>
 
+#include "common.hpp"
+
 #include <black/solver/solver.hpp>
 #include <black/logic/prettyprint.hpp>
 
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <map>
 #include <string_view>
 #include <iostream>
+#include <unordered_map>
+#include <unordered_set>
+
+#if __has_include(<sys/resource.h>)
+  #include <sys/resource.h>
+#endif
+
+#if defined(__linux__)
+  #include <unistd.h>
+#elif defined(__APPLE__)
+  #include <mach/mach.h>
+#endif
 
 namespace purple {
 
   using namespace std::literals;
 
-  static
-  std::optional<logic::scope> scope(domain const& d, problem const& p) {
+  //
+  // Actions with at least `split` parameters are encoded in factored form: a
+  // proposition tells whether the action is executed, and a unary relation
+  // for each parameter tells which object is chosen for it, instead of a 
+  // single relation over all the parameters.
+  //
+  static bool factored(action const& a, size_t split) {
+    return split > 0 && !a.params.empty() && a.params.size() >= split;
+  }
+
+  static logic::relation 
+  argument(logic::alphabet *sigma, action const& a, size_t i) {
+    return sigma->relation(std::tuple{"_arg_"sv, sigma->relation(a.name), i});
+  }
+
+  static bool mentions(logic::formula f, logic::relation r, bool positive);
+
+  bool stratified(domain const& d) {
+    enum class mark { none, visiting, done };
+    std::vector<mark> marks(d.derived.size(), mark::none);
+
+    auto visit = [&](auto &self, size_t i) -> bool {
+      if(marks[i] == mark::visiting)
+        return false;
+      if(marks[i] == mark::done)
+        return true;
+
+      marks[i] = mark::visiting;
+      logic::formula body = d.derived[i].body;
+      for(size_t j = 0; j < d.derived.size(); ++j) {
+        logic::relation r = d.derived[j].head.name;
+        if(mentions(body, r, true) || mentions(body, r, false))
+          if(!self(self, j))
+            return false;
+      }
+      marks[i] = mark::done;
+
+      return true;
+    };
+
+    for(size_t i = 0; i < d.derived.size(); ++i)
+      if(!visit(visit, i))
+        return false;
+
+    return true;
+  }
+
+  static std::optional<logic::scope> 
+  scope(domain const& d, problem const& p, size_t split) {
     logic::alphabet *sigma = d.sigma;
     logic::scope xi{*sigma};
 
@@ -43,50 +108,58 @@ namespace purple {
       xi.declare(decl);
 
     // declare predicates
-    for(predicate pred : d.predicates)
+    for(predicate const& pred : d.predicates)
       xi.declare(pred.name, pred.params);
 
-    // declare relations corresponding to actions
-    for(action a : d.actions)
-      xi.declare(sigma->relation(a.name), a.params);
+    // declare derived predicates, whose definitions must be well-founded
+    if(!stratified(d))
+      return {};
 
-    return xi;
-  }
+    for(derived_predicate const& der : d.derived)
+      xi.declare(der.head.name, der.head.params);
 
-  static logic::formula 
-  _exists(std::vector<logic::var_decl> params, logic::formula matrix) {
-    if(params.empty())
-      return matrix;
-    return black::logic::exists(params, matrix);
-  }
+    // declare relations corresponding to actions
+    for(action const& a : d.actions) {
+      if(!factored(a, split)) {
+        xi.declare(sigma->relation(a.name), a.params);
+        continue;
+      }
 
-  static logic::formula
-  logic_forall(std::vector<logic::var_decl> params, logic::formula matrix) {
-    if(params.empty())
-      return matrix;
-    return black::logic::forall(params, matrix);
+      for(size_t i = 0; i < a.params.size(); ++i)
+        xi.declare(
+          argument(sigma, a, i), std::vector<logic::var_decl>{a.params[i]}
+        );
+    }
+
+    return xi;
   }
 
-  static temporal::formula
-  temporal_forall(
-    std::vector<logic::var_decl> params, temporal::formula matrix
+  static temporal::formula temporal_forall(
+    std::vector<logic::var_decl> const& params, temporal::formula matrix
   ) {
     if(params.empty())
       return matrix;
     return black::logic::forall(params, matrix);
   }
 
-  static 
-  logic::formula apply(action const& a, std::vector<logic::var_decl> decls) 
-  {
+  static logic::formula apply(
+    action const& a, std::vector<logic::var_decl> const& decls, size_t split
+  ) {
+    logic::alphabet *sigma = a.precondition.sigma();
     if(decls.empty())
-      return a.precondition.sigma()->proposition(a.name);
-    auto rel = a.precondition.sigma()->relation(a.name);
-    return rel(decls);
-  }
+      return sigma->proposition(a.name);
 
-  static logic::formula apply(action const& a) {
-    return apply(a, a.params);
+    if(factored(a, split)) {
+      std::vector<logic::formula> args;
+      args.reserve(decls.size());
+      for(size_t i = 0; i < decls.size(); ++i)
+        args.push_back(argument(sigma, a, i)(decls[i].variable()));
+      
+      return sigma->proposition(a.name) && big_and(*sigma, args);
+    }
+
+    auto rel = sigma->relation(a.name);
+    return rel(decls);
   }
 
   static logic::formula encode(effect const& e) {
@@ -129,9 +202,13 @@ namespace purple {
   }
 
   static logic::formula encode(domain const& d, state const& s) {
+    std::unordered_set<identifier> facts;
+    for(logic::proposition prop : s.fluents)
+      facts.insert(prop.name());
+
     std::vector<logic::proposition> negatives;
-    for(auto prop : d.fluents) {
-      if(std::find(s.fluents.begin(), s.fluents.end(), prop) == s.fluents.end())
+    for(logic::proposition prop : d.fluents) {
+      if(!facts.contains(prop.name()))
         negatives.push_back(prop);
     }
 
@@ -140,13 +217,15 @@ namespace purple {
         return !p;
       });
     
+    // initial facts grouped by relation
+    std::unordered_map<identifier, std::vector<logic::atom>> atoms;
+    for(logic::atom a : s.predicates)
+      atoms[a.rel().name()].push_back(a);
+
     logic::formula preds =
       big_and(*d.sigma, d.predicates, [&](predicate const& pred) {
         std::vector<logic::formula> guards;
-        for(logic::atom a : s.predicates) {
-          if(a.rel() != pred.name)
-            continue;
-          
+        for(logic::atom a : atoms[pred.name.name()]) {
           black_assert(pred.params.size() == a.terms().size());
 
           std::vector<logic::formula> eqs;
@@ -164,142 +243,682 @@ namespace purple {
     return props && preds;
   }
 
-  static temporal::formula frame(domain d, logic::proposition p, bool change) {
-    logic::alphabet *sigma = d.sigma;
+  //
+  // Builder of the transition encoding of a domain. It memoizes the formulas
+  // needed many times, i.e., the application of each action and the fact
+  // that no instance of it is applied, and indexes the effects of the 
+  // actions by the fluent or predicate they change, so that each frame axiom 
+  // only mentions the relevant actions.
+  //
+  class encoder 
+  {
+  public:
+    encoder(domain const& d, size_t split);
+
+    size_t split() const { return _split; }
+    bool unchanged() const;
+    size_t built() const { return _built; }
+    size_t reused() const { return _reused; }
+
+    logic::formula apply(size_t a);
+    logic::formula executed(size_t a);
+    temporal::formula transition();
+
+  private:
+    // an effect of an action, as indexes into `domain::actions` and 
+    // `action::effects`
+    struct source {
+      size_t action;
+      size_t effect;
+    };
+
+    // effects making something true (`[true]`) or false (`[false]`)
+    using sources = std::array<std::vector<source>, 2>;
+
+    // effects of the actions, by the fluent or predicate they change
+    struct effect_index {
+      std::unordered_map<identifier, sources> fluents;
+      std::unordered_map<identifier, sources> predicates;
+
+      void add(domain const& d);
+    };
+
+    logic::formula idle(size_t a);
+    logic::formula preconditions();
+    temporal::formula effects();
+    temporal::formula frame(logic::proposition p, bool change);
+    temporal::formula frame(predicate const& p, bool change);
+    logic::formula parallelism();
+    logic::formula definitions();
+
+    template<typename F>
+    logic::formula memoize(std::optional<logic::formula> &entry, F build) {
+      if(entry) {
+        _reused++;
+        return *entry;
+      }
+      _built++;
+      entry = build();
+      return *entry;
+    }
 
-    temporal::formula head = sigma->top();
+    domain const& _d;
+    logic::alphabet *_sigma;
+    size_t _split;
+    size_t _built = 0;
+    size_t _reused = 0;
+
+    std::vector<identifier> _names;
+    std::vector<std::optional<logic::formula>> _applications;
+    std::vector<std::optional<logic::formula>> _executed;
+    std::vector<std::optional<logic::formula>> _idle;
+    effect_index _index;
+  };
+
+  // whether the domain still has the actions it had when the encoder was 
+  // built, as far as their names tell
+  bool encoder::unchanged() const {
+    if(_d.actions.size() != _names.size())
+      return false;
+    
+    for(size_t i = 0; i < _names.size(); ++i)
+      if(_d.actions[i].name != _names[i])
+        return false;
+    
+    return true;
+  }
+
+  void encoder::effect_index::add(domain const& d) {
+    auto add = [](std::vector<source> &v, size_t i, size_t j) {
+      if(v.empty() || v.back().action != i || v.back().effect != j)
+        v.push_back({i, j});
+    };
+
+    for(size_t i = 0; i < d.actions.size(); ++i) {
+      std::vector<effect> const& effects = d.actions[i].effects;
+      for(size_t j = 0; j < effects.size(); ++j) {
+        bool positive = effects[j].positive;
+        for(logic::proposition p : effects[j].fluents)
+          add(fluents[p.name()][positive], i, j);
+        for(logic::atom t : effects[j].predicates)
+          add(predicates[t.rel().name()][positive], i, j);
+      }
+    }
+  }
+
+  encoder::encoder(domain const& d, size_t split) 
+    : _d{d}, _sigma{d.sigma}, _split{split}, 
+      _applications(d.actions.size()), _executed(d.actions.size()), 
+      _idle(d.actions.size())
+  {
+    for(action const& a : d.actions)
+      _names.push_back(a.name);
+
+    _index.add(d);
+  }
+
+  logic::formula encoder::apply(size_t a) {
+    return memoize(_applications[a], [&]{
+      return purple::apply(_d.actions[a], _d.actions[a].params, _split);
+    });
+  }
+
+  // whether some instance of the action is executed. Factored actions are 
+  // executed exactly when their proposition is true, with no quantifier.
+  logic::formula encoder::executed(size_t a) {
+    return memoize(_executed[a], [&]() -> logic::formula {
+      action const& act = _d.actions[a];
+      if(factored(act, _split))
+        return _sigma->proposition(act.name);
+      return _exists(act.params, apply(a));
+    });
+  }
+
+  logic::formula encoder::idle(size_t a) {
+    return memoize(_idle[a], [&]() -> logic::formula {
+      action const& act = _d.actions[a];
+      if(factored(act, _split))
+        return !executed(a);
+      return logic_forall(act.params, !apply(a));
+    });
+  }
+
+  logic::formula encoder::preconditions() {
+    std::vector<logic::formula> blocks;
+    blocks.reserve(_d.actions.size());
+    for(size_t i = 0; i < _d.actions.size(); ++i) {
+      action const& a = _d.actions[i];
+      blocks.push_back(
+        logic_forall(a.params, implies(apply(i), a.precondition))
+      );
+    }
+    
+    return logic::big_and(*_sigma, blocks);
+  }
+
+  temporal::formula encoder::effects() {
+    std::vector<temporal::formula> axioms;
+    for(size_t i = 0; i < _d.actions.size(); ++i) {
+      action const& a = _d.actions[i];
+      for(effect const& e : a.effects)
+        axioms.push_back(temporal_forall(
+          a.params, implies(apply(i) && e.precondition, X(encode(e)))
+        ));
+    }
+
+    return temporal::big_and(*_sigma, axioms);
+  }
+
+  temporal::formula encoder::frame(logic::proposition p, bool change) {
+    temporal::formula head = _sigma->top();
     
     if(change)
       head = !p && X(p);
     else
       head = p && X(!p);
 
-    auto body = big_or(*sigma, d.actions, [&](action const& a) {
-      std::vector<logic::formula> pre;
+    std::vector<logic::formula> disjuncts;
+    std::vector<logic::formula> pre;
+    std::vector<source> const& changes = _index.fluents[p.name()][change];
+    for(size_t k = 0; k < changes.size(); ++k) {
+      action const& a = _d.actions[changes[k].action];
+      pre.push_back(a.effects[changes[k].effect].precondition);
 
-      for(effect const& e : a.effects)
-        if(e.positive == change)
-          for(logic::proposition q : e.fluents)
-            if(p == q)
-              pre.push_back(e.precondition);
-      
-      return _exists(a.params, apply(a) && big_or(*sigma, pre));
-    });
+      if(k + 1 < changes.size() && changes[k + 1].action == changes[k].action)
+        continue;
 
-    return implies(head, body);
-  }
+      disjuncts.push_back(
+        _exists(a.params, apply(changes[k].action) && big_or(*_sigma, pre))
+      );
+      pre.clear();
+    }
 
-  static temporal::formula frame(domain d, predicate p, bool change) {
-    logic::alphabet *sigma = d.sigma;
+    return implies(head, big_or(*_sigma, disjuncts));
+  }
 
-    temporal::formula head = sigma->top();
+  temporal::formula encoder::frame(predicate const& p, bool change) {
+    temporal::formula head = _sigma->top();
     
     if(change)
       head = !p(p.params) && X(p(p.params));
     else
       head = p(p.params) && X(!p(p.params));
 
-    auto body = big_or(*sigma, d.actions, [&](action const& a) {
-      std::vector<logic::formula> mappings;
-      std::vector<logic::formula> pre;
-
-      for(effect const& e : a.effects) {
-        if(e.positive == change) {
-          for(logic::atom t : e.predicates) {
-            if(t.rel() == p.name) {
-              pre.push_back(e.precondition);
-              for(size_t i = 0; i < t.terms().size(); ++i) {
-                mappings.push_back(t.terms()[i] == p.params[i].variable());
-              }
-            }
-          }
+    // each atom changed by an effect of the action explains the change if 
+    // it maps to the params of `p` and the effect takes place
+    std::vector<logic::formula> disjuncts;
+    std::vector<logic::formula> cases;
+    std::vector<source> const& changes = 
+      _index.predicates[p.name.name()][change];
+    for(size_t k = 0; k < changes.size(); ++k) {
+      action const& a = _d.actions[changes[k].action];
+      effect const& e = a.effects[changes[k].effect];
+
+      for(logic::atom t : e.predicates) {
+        if(t.rel() == p.name) {
+          std::vector<logic::formula> mappings;
+          for(size_t i = 0; i < t.terms().size(); ++i)
+            mappings.push_back(t.terms()[i] == p.params[i].variable());
+          
+          cases.push_back(big_and(*_sigma, mappings) && e.precondition);
         }
       }
-      
-      return _exists(a.params, 
-        apply(a) && big_and(*sigma, mappings) && big_or(*sigma, pre)
-      );
-    });
 
-    return temporal_forall(p.params, implies(head, body));
+      if(k + 1 < changes.size() && changes[k + 1].action == changes[k].action)
+        continue;
+
+      disjuncts.push_back(_exists(a.params, 
+        apply(changes[k].action) && big_or(*_sigma, cases)
+      ));
+      cases.clear();
+    }
+
+    return temporal_forall(
+      p.params, implies(head, big_or(*_sigma, disjuncts))
+    );
   }
 
-  static logic::formula parallelism(domain const& d) {
+  logic::formula encoder::parallelism() {
     std::vector<logic::formula> axioms;
 
-    for(action const& a1 : d.actions) {
-      for(action const& a2 : d.actions) {
-        if(a1.name == a2.name)
+    // the disjunction is symmetric, so each pair is taken once
+    for(size_t i = 0; i < _d.actions.size(); ++i) {
+      for(size_t j = i + 1; j < _d.actions.size(); ++j) {
+        if(_d.actions[i].name == _d.actions[j].name)
           continue;
-        axioms.push_back(
-          _exists(a1.params, !apply(a1)) || 
-          _exists(a2.params, !apply(a2))
-        );
+        axioms.push_back(idle(i) || idle(j));
       }
     }
 
-    for(action const& a : d.actions) { 
+    for(size_t k = 0; k < _d.actions.size(); ++k) {
+      action const& a = _d.actions[k];
       std::vector<logic::var_decl> primes;
+      primes.reserve(a.params.size());
       for(logic::var_decl decl : a.params) {
         logic::variable prime = 
-          d.sigma->variable(std::tuple{"_prime_"sv, decl.variable()});
-        primes.push_back(d.sigma->var_decl(prime, decl.sort()));
+          _sigma->variable(std::tuple{"_prime_"sv, decl.variable()});
+        primes.push_back(_sigma->var_decl(prime, decl.sort()));
+      }
+
+      if(factored(a, _split)) {
+        // each parameter is chosen iff the action is executed, and uniquely
+        logic::proposition executed = _sigma->proposition(a.name);
+        for(size_t i = 0; i < a.params.size(); ++i) {
+          logic::relation arg = argument(_sigma, a, i);
+          logic::variable x = a.params[i].variable();
+          logic::variable y = primes[i].variable();
+
+          axioms.push_back(implies(executed, _exists({a.params[i]}, arg(x))));
+          axioms.push_back(
+            logic_forall({a.params[i]}, 
+              implies(arg(x), executed && logic_forall({primes[i]}, 
+                implies(arg(y), x == y)
+              ))
+            )
+          );
+        }
+        continue;
       }
 
       std::vector<logic::formula> guards;
       for(size_t i = 0; i < a.params.size(); ++i)
         guards.push_back(a.params[i].variable() != primes[i].variable());
       
-      logic::formula guard = big_or(*d.sigma, guards);
+      logic::formula guard = big_or(*_sigma, guards);
 
       axioms.push_back(
         logic_forall(a.params, 
-          implies(apply(a), logic_forall(primes, 
-            implies(guard, !apply(a, primes))
+          implies(apply(k), logic_forall(primes, 
+            implies(guard, !purple::apply(a, primes, _split))
           ))
         )
       );
     }
 
-    return logic::big_and(*d.sigma, axioms);
+    return logic::big_and(*_sigma, axioms);
   }
 
-  static temporal::formula 
-  encode(domain const& d, problem const& p) 
+  // derived predicates are defined anew in each state, without frame axioms
+  logic::formula encoder::definitions() {
+    return big_and(*_sigma, _d.derived, [](derived_predicate const& der) {
+      return logic_forall(
+        der.head.params, iff(der.head(der.head.params), der.body)
+      );
+    });
+  }
+
+  temporal::formula encoder::transition() {
+    std::vector<temporal::formula> frames;
+    for(predicate const& pred : _d.predicates) {
+      frames.push_back(frame(pred, true));
+      frames.push_back(frame(pred, false));
+    }
+    for(logic::proposition prop : _d.fluents) {
+      frames.push_back(frame(prop, true));
+      frames.push_back(frame(prop, false));
+    }
+
+    return G(
+      preconditions() && effects() && 
+      temporal::big_and(*_sigma, frames) && parallelism() && definitions()
+    );
+  }
+
+  // a constraint compiled into conditions over its monitor fluent `m`, on 
+  // the initial state, on each step, and on the final state
+  struct monitor {
+    logic::formula init;
+    temporal::formula step;
+    logic::formula end;
+  };
+
+  static monitor encode(logic::alphabet *sigma, constraint const& c, size_t i)
   {
-    logic::alphabet *sigma = d.sigma;
+    logic::proposition m = sigma->proposition(std::tuple{"_monitor_"sv, i});
+    logic::formula phi = c.first;
+    logic::formula psi = c.second;
+
+    switch(c.kind) {
+      case constraint::always:
+        return {sigma->top(), phi, sigma->top()};
+      case constraint::sometime: // m: phi held at some point until now
+        return {implies(m, phi), implies(X(m), m || X(phi)), m};
+      case constraint::at_most_once: // m: phi held and then stopped holding
+        return {
+          sigma->top(), 
+          implies(m || (phi && X(!phi)), wX(m)) && implies(m, !phi),
+          sigma->top()
+        };
+      case constraint::sometime_before: // m: psi held strictly before now
+        return {!m, implies(X(m), m || psi) && implies(phi, m), sigma->top()};
+      case constraint::sometime_after: // m: phi held and psi did not since
+        return {
+          implies(phi && !psi, m),
+          implies((m || X(phi)) && X(!psi), X(m)), 
+          !m
+        };
+    }
 
-    logic::formula init = encode(d, p.init);
+    black_unreachable();
+  }
 
-    logic::formula preconditions = 
-      logic::big_and(*sigma, d.actions, [&](action const& a) {
-        return logic_forall(a.params, implies(apply(a), a.precondition));
-      });
+  template<typename Syntax>
+  static bool occurs(black::logic::term<Syntax> t, logic::variable v) {
+    using namespace black::logic;
 
-    temporal::formula effects = 
-      temporal::big_and(*sigma, d.actions, [&](action const& a) {
-        return temporal::big_and(*sigma, a.effects, [&](effect const& e) {
-          return temporal_forall(
-            a.params, implies(apply(a) && e.precondition, X(encode(e)))
-          );
+    return t.match(
+      [&](variable x) { 
+        return x.name() == v.name(); 
+      },
+      [&](application<Syntax>, auto, auto terms) {
+        for(auto arg : terms)
+          if(occurs(arg, v))
+            return true;
+        return false;
+      },
+      [](otherwise) { return true; } // conservatively
+    );
+  }
+
+  template<typename Syntax>
+  static bool occurs(black::logic::formula<Syntax> f, logic::variable v) {
+    using namespace black::logic;
+
+    auto any = [&](auto terms) {
+      for(auto t : terms)
+        if(occurs(t, v))
+          return true;
+      return false;
+    };
+
+    return f.match(
+      [](boolean) { return false; },
+      [](proposition) { return false; },
+      [&](atom<Syntax>, auto, auto terms) { return any(terms); },
+      [&](equality<Syntax>, auto terms) { return any(terms); },
+      [&](quantifier<Syntax> q) {
+        return occurs(q.matrix(), v);
+      },
+      [&](unary<Syntax>, auto arg) {
+        return occurs(arg, v);
+      },
+      [&](binary<Syntax>, auto left, auto right) {
+        return occurs(left, v) || occurs(right, v);
+      },
+      [](otherwise) { return true; } // conservatively
+    );
+  }
+
+  //
+  // Symmetry detection. Two objects of the same sort are interchangeable if
+  // they are not mentioned in the domain, the goal, the trajectory or the 
+  // constraints, and swapping them maps the initial state to itself. Since
+  // interchangeability is closed under composition of swaps, objects are 
+  // grouped into classes by comparing them with a representative of each 
+  // class.
+  //
+  using fact = std::vector<identifier>; // relation name followed by arguments
+
+  struct fact_hash {
+    size_t operator()(fact const& f) const {
+      size_t h = 0;
+      for(identifier const& id : f)
+        h = h * 31 + std::hash<identifier>{}(id);
+      return h;
+    }
+  };
+
+  using symmetry_class = std::pair<logic::sort, std::vector<logic::variable>>;
+
+  static std::vector<symmetry_class> symmetries(
+    domain const& d, problem const& p, std::vector<query> const& queries
+  ) {
+    std::vector<logic::formula> formulas;
+    for(query const& q : queries)
+      formulas.push_back(q.goal);
+    for(action const& a : d.actions) {
+      formulas.push_back(a.precondition);
+      for(effect const& e : a.effects) {
+        formulas.push_back(e.precondition);
+        for(logic::atom t : e.predicates)
+          formulas.push_back(t);
+      }
+    }
+    for(derived_predicate const& der : d.derived)
+      formulas.push_back(der.body);
+    for(constraint const& c : p.constraints) {
+      formulas.push_back(c.first);
+      formulas.push_back(c.second);
+    }
+
+    auto mentioned = [&](logic::variable v) {
+      for(query const& q : queries)
+        if(occurs(q.trajectory, v))
+          return true;
+      for(logic::formula f : formulas)
+        if(occurs(f, v))
+          return true;
+      return false;
+    };
+
+    std::vector<fact> facts;
+    std::unordered_set<fact, fact_hash> init;
+    std::unordered_map<identifier, std::vector<size_t>> occurrences;
+    for(logic::atom a : p.init.predicates) {
+      fact f = {a.rel().name()};
+      for(logic::term t : a.terms()) {
+        auto x = t.to<logic::variable>();
+        if(!x)
+          return {};
+        f.push_back(x->name());
+      }
+      for(size_t i = 1; i < f.size(); ++i)
+        occurrences[f[i]].push_back(facts.size());
+      init.insert(f);
+      facts.push_back(std::move(f));
+    }
+
+    auto interchangeable = [&](identifier x, identifier y) {
+      std::vector<size_t> const& xs = occurrences[x];
+      std::vector<size_t> const& ys = occurrences[y];
+      if(xs.size() != ys.size())
+        return false;
+
+      for(auto const* indexes : {&xs, &ys}) {
+        for(size_t i : *indexes) {
+          fact swapped = facts[i];
+          for(size_t j = 1; j < swapped.size(); ++j) {
+            if(swapped[j] == x)
+              swapped[j] = y;
+            else if(swapped[j] == y)
+              swapped[j] = x;
+          }
+          if(!init.contains(swapped))
+            return false;
+        }
+      }
+      return true;
+    };
+
+    std::unordered_map<identifier, size_t> sorts;
+    for(logic::sort_decl decl : p.types)
+      for(logic::variable x : decl.domain()->elements())
+        sorts[x.name()]++;
+
+    std::vector<symmetry_class> result;
+    for(logic::sort_decl decl : p.types) {
+      std::vector<std::vector<logic::variable>> classes;
+      for(logic::variable x : decl.domain()->elements()) {
+        if(sorts[x.name()] != 1 || mentioned(x))
+          continue;
+
+        auto it = std::find_if(classes.begin(), classes.end(), [&](auto &c) {
+          return interchangeable(c.front().name(), x.name());
         });
-      });
-   
-    temporal::formula frames = 
-      big_and(*sigma, d.predicates, [&](predicate const& pred) {
-        return frame(d, pred, true) && frame(d, pred, false);
-      }) &&
-      big_and(*sigma, d.fluents, [&](logic::proposition prop) {
-        return frame(d, prop, true) && frame(d, prop, false);
-      });
+        if(it != classes.end())
+          it->push_back(x);
+        else
+          classes.push_back({x});
+      }
 
-    logic::formula semantics = parallelism(d);
+      for(auto &c : classes)
+        if(c.size() > 1)
+          result.push_back({decl.sort(), std::move(c)});
+    }
 
-    temporal::formula transition = 
-      preconditions && effects && frames && semantics;
+    return result;
+  }
 
-    return 
-      init && G(transition) && p.trajectory && F(p.goal && wX(sigma->bottom()));
+  //
+  // Lex-leader symmetry breaking on the first step. Taking the parameters of 
+  // the first action in order, those ranging over a class of interchangeable
+  // objects can only take an object of the class already taken by an 
+  // earlier parameter, or the first one not taken yet. Any plan can be 
+  // mapped into one of this form by permuting the objects of the class, 
+  // since the initial state and everything else are invariant under it.
+  // The objects that can not be the first choice of the class are counted in
+  // `excluded`, for each class where some action has a parameter to guard.
+  //
+  static logic::formula symmetry_breaking(
+    domain const& d, problem const& p, std::vector<query> const& queries, 
+    encoder &enc, size_t &excluded
+  ) {
+    std::vector<logic::formula> axioms;
+
+    for(symmetry_class const& sc : symmetries(d, p, queries)) {
+      logic::sort s = sc.first;
+      std::vector<logic::variable> const& c = sc.second;
+      bool guarded = false;
+      for(size_t k = 0; k < d.actions.size(); ++k) {
+        action const& a = d.actions[k];
+
+        std::vector<logic::formula> guards;
+        std::vector<logic::variable> earlier;
+        for(logic::var_decl decl : a.params) {
+          if(!(decl.sort() == s))
+            continue;
+
+          logic::variable x = decl.variable();
+          for(size_t j = 1; j < c.size(); ++j) {
+            std::vector<logic::formula> taken;
+            for(logic::variable y : earlier)
+              taken.push_back(y == c[j] || y == c[j - 1]);
+            guards.push_back(implies(x == c[j], big_or(*d.sigma, taken)));
+          }
+          earlier.push_back(x);
+        }
+        if(guards.empty())
+          continue;
+
+        guarded = true;
+        axioms.push_back(
+          logic_forall(a.params, 
+            implies(enc.apply(k), big_and(*d.sigma, guards))
+          )
+        );
+      }
+
+      if(guarded)
+        excluded += c.size() - 1;
+    }
+
+    return big_and(*d.sigma, axioms);
+  }
+
+  //
+  // Bounds the total cost of the executed actions by `bound`, with an order
+  // encoding of the cost spent so far: `_cost_ j` holds if at least `j` has
+  // been spent before the current state. Costs add up along the steps since
+  // a single action is executed at each of them. Actions are grouped by 
+  // cost, so that there is an implication for each distinct cost and each 
+  // `j` up to the bound, built again at each round of `optimize()`.
+  //
+  static temporal::formula 
+  cost_bound(domain const& d, encoder &enc, size_t bound) {
+    logic::alphabet *sigma = d.sigma;
+
+    auto spent = [&](size_t j) -> logic::formula {
+      if(j == 0)
+        return sigma->top();
+      return sigma->proposition(std::tuple{"_cost_"sv, j});
+    };
+
+    std::vector<logic::formula> init;
+    std::vector<temporal::formula> steps;
+    for(size_t j = 1; j <= bound + 1; ++j) {
+      init.push_back(!spent(j));
+      steps.push_back(implies(spent(j), wX(spent(j))));
+    }
+    steps.push_back(!spent(bound + 1));
+
+    std::map<size_t, std::vector<logic::formula>> costs;
+    for(size_t i = 0; i < d.actions.size(); ++i)
+      if(d.actions[i].cost > 0)
+        costs[d.actions[i].cost].push_back(enc.executed(i));
+
+    for(auto const& [cost, executed] : costs) {
+      logic::formula paid = big_or(*sigma, executed);
+      for(size_t j = 1; j <= bound + 1; ++j) {
+        size_t before = j > cost ? j - cost : 0;
+        steps.push_back(implies(paid && spent(before), wX(spent(j))));
+      }
+    }
+
+    return big_and(*sigma, init) && G(temporal::big_and(*sigma, steps));
+  }
+
+  // marks, in the initial state, the query chosen among many to be solved
+  static logic::proposition selector(logic::alphabet *sigma, size_t i) {
+    return sigma->proposition(std::tuple{"_query_"sv, i});
+  }
+
+  //
+  // Encodes `p` with the goal and trajectory of `queries` in place of its own.
+  // If there are many queries, the encoding asks for any of them to be 
+  // satisfied, and the selectors of the satisfied ones can be true.
+  //
+  static temporal::formula encode(
+    domain const& d, problem const& p, std::vector<query> const& queries,
+    temporal::formula transition, encoder &enc, std::optional<size_t> bound,
+    size_t &excluded
+  ) {
+    logic::alphabet *sigma = d.sigma;
+
+    logic::formula init = 
+      encode(d, p.init) && symmetry_breaking(d, p, queries, enc, excluded);
+    logic::formula end = sigma->top();
+    std::vector<temporal::formula> steps;
+
+    for(size_t i = 0; i < p.constraints.size(); ++i) {
+      monitor m = encode(sigma, p.constraints[i], i);
+      init = init && m.init;
+      steps.push_back(m.step);
+      end = end && m.end;
+    }
+
+    if(!steps.empty())
+      transition = transition && G(temporal::big_and(*sigma, steps));
+
+    if(bound)
+      transition = transition && cost_bound(d, enc, *bound);
+
+    temporal::formula last = end && wX(sigma->bottom());
+    if(queries.size() == 1)
+      return init && transition && 
+        queries[0].trajectory && F(queries[0].goal && last);
+
+    std::vector<temporal::formula> choices;
+    std::vector<logic::formula> selectors;
+    for(size_t i = 0; i < queries.size(); ++i) {
+      logic::proposition s = selector(sigma, i);
+      selectors.push_back(s);
+      choices.push_back(
+        implies(s, queries[i].trajectory && F(queries[i].goal && last))
+      );
+    }
+
+    return init && transition && 
+      big_or(*sigma, selectors) && temporal::big_and(*sigma, choices);
   }
 
   [[maybe_unused]]
@@ -325,23 +944,228 @@ namespace purple {
     }
   }
 
+  // high-water mark of the resident memory of the whole process
+  static size_t peak_memory() {
+  #if __has_include(<sys/resource.h>)
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0)
+      return 0;
+    
+    #ifdef __APPLE__
+      return static_cast<size_t>(usage.ru_maxrss);
+    #else
+      return static_cast<size_t>(usage.ru_maxrss) * 1024;
+    #endif
+  #else
+    return 0;
+  #endif
+  }
+
+  // current resident memory of the whole process, or 0 if unknown
+  static size_t resident_memory() {
+  #if defined(__linux__)
+    std::ifstream statm("/proc/self/statm");
+    size_t size = 0;
+    size_t resident = 0;
+    long page = sysconf(_SC_PAGESIZE);
+    if(!(statm >> size >> resident) || page <= 0)
+      return 0;
+    
+    return resident * static_cast<size_t>(page);
+  #elif defined(__APPLE__)
+    mach_task_basic_info info;
+    mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+    kern_return_t error = task_info(
+      mach_task_self(), MACH_TASK_BASIC_INFO, 
+      reinterpret_cast<task_info_t>(&info), &count
+    );
+    if(error != KERN_SUCCESS)
+      return 0;
+    
+    return static_cast<size_t>(info.resident_size);
+  #else
+    return 0;
+  #endif
+  }
+
+  // defined here, where `encoder` is complete
+  solver::solver() = default;
+  solver::~solver() = default;
+  solver::solver(solver&&) = default;
+  solver &solver::operator=(solver&&) = default;
+
+  void solver::prepare(domain const& d) {
+    _d = &d;
+    _encoder = std::make_unique<encoder>(d, _split_arity);
+    _transition = _encoder->transition();
+
+    _stats = {};
+    _stats.encoded = _encoder->built();
+    _stats.reused = _encoder->reused();
+  }
+
   tribool solver::solve(domain const& d, problem const& p) {
+    prepare(d);
+    return run(p, {{p.goal, p.trajectory}});
+  }
+
+  tribool solver::replan(problem const& p) {
+    // the actions of the domain must not have changed since `solve()`, e.g.,
+    // by learning macros
+    if(!_d || !_transition || !_encoder->unchanged())
+      return tribool::undef;
+
+    _stats = {};
+    return run(p, {{p.goal, p.trajectory}});
+  }
+
+  std::vector<solver::answer> solver::solve(
+    domain const& d, problem const& p, std::vector<query> const& queries
+  ) {
+    prepare(d);
+
+    std::vector<answer> answers(queries.size());
+    std::vector<size_t> pending(queries.size());
+    for(size_t i = 0; i < pending.size(); ++i)
+      pending[i] = i;
+
+    while(!pending.empty()) {
+      std::vector<query> current;
+      for(size_t i : pending)
+        current.push_back(queries[i]);
+
+      tribool result = run(p, current);
+      if(result != true) {
+        for(size_t i : pending)
+          answers[i].result = result;
+        break;
+      }
+
+      std::optional<plan> s = solution();
+      std::vector<size_t> left;
+      for(size_t k = 0; k < pending.size(); ++k) {
+        bool chosen = current.size() == 1 || 
+          _slv.model()->value(selector(_d->sigma, k), 0) == true;
+        if(chosen)
+          answers[pending[k]] = {true, s};
+        else
+          left.push_back(pending[k]);
+      }
+
+      // the model must satisfy some selector, but should none read back as
+      // true, the remaining queries are left unanswered rather than looping
+      if(left.size() == pending.size()) {
+        for(size_t i : pending)
+          answers[i].result = tribool::undef;
+        break;
+      }
+      pending = std::move(left);
+    }
+
+    return answers;
+  }
+
+  std::vector<solver::answer> 
+  solver::solve(domain const& d, std::vector<problem> const& problems) {
+    prepare(d);
+
+    std::vector<answer> answers;
+    for(problem const& p : problems) {
+      tribool result = run(p, {{p.goal, p.trajectory}});
+      if(result == true)
+        answers.push_back({result, solution()});
+      else
+        answers.push_back({result, std::nullopt});
+    }
+    
+    clear();
+    return answers;
+  }
+
+  tribool solver::optimize(
+    domain const& d, problem const& p, 
+    std::function<void(plan const&, size_t)> f
+  ) {
+    prepare(d);
+
+    std::optional<size_t> bound;
+    while(true) {
+      tribool result = run(p, {{p.goal, p.trajectory}}, bound);
+      if(result == tribool::undef)
+        return tribool::undef;
+      if(result == false)
+        return bound.has_value();
+
+      std::optional<plan> s = solution();
+      black_assert(s.has_value());
+
+      size_t cost = 0;
+      for(plan::step const& step : s->steps)
+        cost += step.action.cost;
+      
+      f(*s, cost);
+      if(cost == 0)
+        return true;
+      bound = cost - 1;
+    }
+  }
+
+  tribool solver::run(
+    problem const& p, std::vector<query> const& queries, 
+    std::optional<size_t> bound
+  ) {
     _slv = black::solver{};
-    _d = &d;
     _p = &p;
 
-    std::optional<logic::scope> xi = scope(d, p);
+    size_t memory = resident_memory();
+    size_t encoded = _encoder->built();
+    size_t reused = _encoder->reused();
+
+    std::optional<logic::scope> xi = scope(*_d, p, _encoder->split());
     if(!xi)
       return tribool::undef;
 
-    temporal::formula encoding = encode(d, p);
+    // symmetries are found again for each encoding, so only the last counts
+    _stats.symmetric = 0;
+    temporal::formula encoding = 
+      encode(*_d, p, queries, *_transition, *_encoder, bound, _stats.symmetric);
+
+    _stats.encoded += _encoder->built() - encoded;
+    _stats.reused += _encoder->reused() - reused;
     
     //std::cerr << to_string(encoding) << "\n";
 
     //_slv.set_tracer(tracer);
     //_slv.set_sat_backend("cvc5");
 
-    return _slv.solve(*xi, encoding, /* finite = */ true); //, 9000, true);
+    struct timeout { };
+    if(_deadline) {
+      _slv.set_tracer([&](black::solver::trace_t trace) {
+        if(trace.type == black::solver::trace_t::stage && 
+           clock::now() >= *_deadline)
+          throw timeout{};
+      });
+    }
+
+    tribool result = tribool::undef;
+    try {
+      result = _slv.solve(*xi, encoding, /* finite = */ true); //, 9000, true);
+    } catch(timeout const&) {
+      _slv = black::solver{};
+    }
+
+    // the black::solver is still alive, so its memory is accounted for
+    _stats.peak_memory = peak_memory();
+    _stats.resident_memory = resident_memory();
+    if(_stats.resident_memory > memory)
+      _stats.memory_growth += _stats.resident_memory - memory;
+
+    return result;
+  }
+
+  void solver::clear() {
+    _slv = black::solver{};
+    _p = nullptr;
   }
 
   static std::optional<logic::domain_ref>
@@ -368,12 +1192,14 @@ namespace purple {
   }
 
 
-  std::optional<plan::step> solver::get_step(size_t t) const {
-    for(action const &a : _d->actions) {
+  std::optional<compact_plan::step> solver::get_step(size_t t) const {
+    for(size_t i = 0; i < _d->actions.size(); ++i) {
+      action const& a = _d->actions[i];
       if(a.params.empty()) {
         logic::proposition p = _d->sigma->proposition(a.name);
+        _stats.queries++;
         if(_slv.model()->value(p, t))
-          return plan::step{a, {}};
+          return compact_plan::step{i, {}};
         continue;
       }
 
@@ -383,16 +1209,41 @@ namespace purple {
         black_assert(dom.has_value());
         domains.push_back(*dom);
       }
+
+      if(factored(a, _encoder->split())) {
+        logic::proposition p = _d->sigma->proposition(a.name);
+        _stats.queries++;
+        if(!_slv.model()->value(p, t))
+          continue;
+
+        std::vector<logic::variable> args;
+        for(size_t j = 0; j < domains.size(); ++j) {
+          logic::relation arg = argument(_d->sigma, a, j);
+          for(logic::variable x : domains[j]->elements()) {
+            _stats.queries++;
+            if(_slv.model()->value(arg(x), t)) {
+              args.push_back(x);
+              break;
+            }
+          }
+        }
+        black_assert(args.size() == a.params.size());
+
+        return compact_plan::step{i, std::move(args)};
+      }
+
+      logic::relation rel = _d->sigma->relation(a.name);
       std::vector<size_t> indexes(domains.size(), 0);
+      std::vector<logic::variable> args;
       do {
-        std::vector<logic::variable> args;
-        for(size_t i = 0; i < domains.size(); i++) {
-          args.push_back(domains[i]->elements()[indexes[i]]);
+        args.clear();
+        for(size_t j = 0; j < domains.size(); j++) {
+          args.push_back(domains[j]->elements()[indexes[j]]);
         }
         
-        logic::relation rel = _d->sigma->relation(a.name);
+        _stats.queries++;
         if(_slv.model()->value(rel(args), t)) {
-          return plan::step{a, args};
+          return compact_plan::step{i, std::move(args)};
         }
       } while(increment(indexes, domains));
     }
@@ -400,18 +1251,62 @@ namespace purple {
     return {};
   }
 
-  std::optional<plan> solver::solution() const {
-    if(!_d || !_p)
-      return {};
+  // calls `f` on the primitive steps that `step` stands for
+  static void expand(
+    domain const& d, compact_plan::step step, 
+    std::function<void(compact_plan::step)> const& f
+  ) {
+    for(macro const& m : d.macros) {
+      if(m.name != d.actions[step.action].name)
+        continue;
+      
+      for(macro::step const& s : m.steps) {
+        std::vector<logic::variable> args;
+        for(size_t slot : s.args)
+          args.push_back(step.args[slot]);
+        expand(d, compact_plan::step{s.action, std::move(args)}, f);
+      }
+      return;
+    }
 
-    plan s;
+    f(std::move(step));
+  }
+
+  bool 
+  solver::for_each_step(std::function<void(compact_plan::step)> f) const {
+    if(!_d || !_p || !_slv.model())
+      return false;
 
     for(size_t t = 0; t < _slv.model()->size() - 1; ++t) {
       auto step = get_step(t);
       black_assert(step.has_value());
-      s.steps.push_back(*step);
+      expand(*_d, std::move(*step), f);
     }
+
+    return true;
+  }
+
+  std::optional<compact_plan> solver::compact_solution() const {
+    compact_plan s;
+
+    bool found = for_each_step([&](compact_plan::step step) {
+      s.steps.push_back(std::move(step));
+    });
     
+    if(!found)
+      return {};
+    return s;
+  }
+
+  std::optional<plan> solver::solution() const {
+    plan s;
+
+    bool found = for_each_step([&](compact_plan::step step) {
+      s.steps.push_back(plan::step{_d->actions[step.action], step.args});
+    });
+    
+    if(!found)
+      return {};
     return s;
   }
 
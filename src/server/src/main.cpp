@@ -0,0 +1,170 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "protocol.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace purple::server {
+
+  // buffered line-oriented reads and writes on a connected socket
+  class connection {
+  public:
+    explicit connection(int fd) : _fd{fd} { }
+    ~connection() { close(_fd); }
+
+    connection(connection const&) = delete;
+    connection &operator=(connection const&) = delete;
+
+    std::optional<std::string> read_line() {
+      while(true) {
+        size_t newline = _buffer.find('\n');
+        if(newline != std::string::npos) {
+          std::string line = _buffer.substr(0, newline);
+          _buffer.erase(0, newline + 1);
+          if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+          return line;
+        }
+
+        char chunk[4096];
+        ssize_t n = ::read(_fd, chunk, sizeof(chunk));
+        if(n < 0 && errno == EINTR)
+          continue;
+        if(n <= 0)
+          return {};
+        _buffer.append(chunk, static_cast<size_t>(n));
+      }
+    }
+
+    bool write(std::string const& data) {
+      size_t written = 0;
+      while(written < data.size()) {
+        ssize_t n = ::write(_fd, data.data() + written, data.size() - written);
+        if(n < 0 && errno == EINTR)
+          continue;
+        if(n <= 0)
+          return false;
+        written += static_cast<size_t>(n);
+      }
+      return true;
+    }
+
+  private:
+    int _fd;
+    std::string _buffer;
+  };
+
+  static void serve(int fd, registry &r) {
+    connection conn{fd};
+
+    while(true) {
+      std::vector<std::string> request;
+      while(true) {
+        std::optional<std::string> line = conn.read_line();
+        if(!line)
+          return;
+        if(*line == "end")
+          break;
+        request.push_back(std::move(*line));
+      }
+
+      if(!conn.write(handle(r, request)))
+        return;
+    }
+  }
+
+}
+
+int main(int argc, char **argv) {
+  if(argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <socket path>\n";
+    return 1;
+  }
+
+  std::string path = argv[1];
+
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  if(path.size() >= sizeof(addr.sun_path)) {
+    std::cerr << "Socket path too long: " << path << "\n";
+    return 1;
+  }
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0) {
+    std::perror("socket");
+    return 1;
+  }
+
+  // a socket left by a previous run is replaced, but nothing else is
+  struct stat st;
+  if(lstat(path.c_str(), &st) == 0) {
+    if(!S_ISSOCK(st.st_mode)) {
+      std::cerr << "Not a socket: " << path << "\n";
+      return 1;
+    }
+    unlink(path.c_str());
+  }
+
+  if(bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+    std::perror("bind");
+    return 1;
+  }
+
+  if(listen(fd, SOMAXCONN) < 0) {
+    std::perror("listen");
+    return 1;
+  }
+
+  // replies to clients that went away must not kill the server
+  std::signal(SIGPIPE, SIG_IGN);
+
+  purple::server::registry registry;
+
+  while(true) {
+    int client = accept(fd, nullptr, nullptr);
+    if(client < 0) {
+      if(errno == EINTR || errno == ECONNABORTED)
+        continue;
+      std::perror("accept");
+      break;
+    }
+
+    std::thread{purple::server::serve, client, std::ref(registry)}.detach();
+  }
+
+  close(fd);
+  return 1;
+}
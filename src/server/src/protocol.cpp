@@ -0,0 +1,380 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "protocol.hpp"
+
+#include <black/logic/parser.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <sstream>
+#include <string_view>
+
+namespace purple::server {
+
+  using namespace std::literals;
+
+  void registry::insert(std::string const& name, std::shared_ptr<workspace> w)
+  {
+    std::lock_guard lock{_mutex};
+    _domains[name] = std::move(w);
+  }
+
+  std::shared_ptr<workspace> registry::find(std::string const& name) {
+    std::lock_guard lock{_mutex};
+    auto it = _domains.find(name);
+    if(it == _domains.end())
+      return nullptr;
+    return it->second;
+  }
+
+  // splits the keyword at the start of the line from the rest of it
+  static std::pair<std::string, std::string> keyword(std::string const& line) 
+  {
+    size_t begin = line.find_first_not_of(' ');
+    if(begin == std::string::npos)
+      return {};
+    size_t end = line.find(' ', begin);
+    if(end == std::string::npos)
+      return {line.substr(begin), ""};
+    return {line.substr(begin, end - begin), line.substr(end + 1)};
+  }
+
+  static std::vector<std::string> words(std::string const& s) {
+    std::vector<std::string> result;
+    std::istringstream stream{s};
+    std::string word;
+    while(stream >> word)
+      result.push_back(word);
+    return result;
+  }
+
+  static temporal::formula 
+  parse_temporal(black::alphabet &sigma, std::string const& s) {
+    std::string message;
+    auto f = black::parse_formula(sigma, s, [&](auto msg) {
+      message = msg;
+    });
+    if(!f)
+      throw error{"syntax error: " + message};
+    
+    auto result = f->to<temporal::formula>();
+    if(!result)
+      throw error{"unsupported formula: " + s};
+    return *result;
+  }
+
+  static logic::formula 
+  parse_formula(black::alphabet &sigma, std::string const& s) {
+    auto f = parse_temporal(sigma, s).to<logic::formula>();
+    if(!f)
+      throw error{"expected a non-temporal formula: " + s};
+    return *f;
+  }
+
+  struct literal {
+    std::optional<logic::atom> atom;
+    std::optional<logic::proposition> fluent;
+    bool positive = true;
+  };
+
+  static literal parse_literal(black::alphabet &sigma, std::string const& s) {
+    literal l;
+    logic::formula f = parse_formula(sigma, s);
+    if(auto n = f.to<logic::negation>(); n) {
+      f = n->argument();
+      l.positive = false;
+    }
+
+    l.atom = f.to<logic::atom>();
+    l.fluent = f.to<logic::proposition>();
+    if(!l.atom && !l.fluent)
+      throw error{"expected an atom or a fluent: " + s};
+
+    return l;
+  }
+
+  static logic::named_sort 
+  sort_of(black::alphabet &sigma, std::string const& s) {
+    return sigma.named_sort(s);
+  }
+
+  std::shared_ptr<workspace> parse_domain(std::vector<std::string> const& lines)
+  {
+    auto w = std::make_shared<workspace>();
+    w->sigma = std::make_unique<black::alphabet>();
+    black::alphabet &sigma = *w->sigma;
+    w->domain.sigma = &sigma;
+
+    for(std::string const& line : lines) {
+      auto [key, rest] = keyword(line);
+      
+      if(key.empty())
+        continue;
+
+      if(key == "sort") {
+        for(std::string const& s : words(rest))
+          w->domain.types.push_back(sort_of(sigma, s));
+        continue;
+      }
+
+      if(key == "fluent") {
+        for(std::string const& f : words(rest))
+          w->domain.fluents.push_back(sigma.proposition(f));
+        continue;
+      }
+
+      if(key == "predicate") {
+        std::vector<std::string> args = words(rest);
+        if(args.empty())
+          throw error{"missing predicate name"};
+        
+        std::vector<black::var_decl> params;
+        for(size_t i = 1; i < args.size(); ++i) {
+          logic::variable x = sigma.variable(std::tuple{"_param_"sv, i});
+          params.push_back(x[sort_of(sigma, args[i])]);
+        }
+        w->domain.predicates.push_back({sigma.relation(args[0]), params});
+        continue;
+      }
+
+      if(key == "action") {
+        std::vector<std::string> args = words(rest);
+        if(args.empty())
+          throw error{"missing action name"};
+        
+        std::vector<black::var_decl> params;
+        for(size_t i = 1; i < args.size(); ++i) {
+          size_t colon = args[i].find(':');
+          if(colon == std::string::npos)
+            throw error{"expected <var>:<sort>, found: " + args[i]};
+          logic::variable x = sigma.variable(args[i].substr(0, colon));
+          params.push_back(x[sort_of(sigma, args[i].substr(colon + 1))]);
+        }
+
+        w->domain.actions.push_back({args[0], params, sigma.top(), {}});
+        w->actions.push_back(args[0]);
+        continue;
+      }
+
+      if(w->domain.actions.empty())
+        throw error{"`" + key + "` must follow an action"};
+      action &a = w->domain.actions.back();
+
+      if(key == "pre") {
+        a.precondition = parse_formula(sigma, rest);
+        continue;
+      }
+      
+      if(key == "effect") {
+        logic::formula pre = sigma.top();
+        size_t cond = rest.find(" if ");
+        if(cond != std::string::npos) {
+          pre = parse_formula(sigma, rest.substr(cond + 4));
+          rest = rest.substr(0, cond);
+        }
+
+        literal l = parse_literal(sigma, rest);
+        if(l.atom)
+          a.effects.push_back(effect{pre, *l.atom, l.positive});
+        else
+          a.effects.push_back(effect{pre, *l.fluent, l.positive});
+        continue;
+      }
+
+      throw error{"unknown domain declaration: " + key};
+    }
+
+    return w;
+  }
+
+  static constraint::kind_t kind(std::string const& s) {
+    if(s == "always")
+      return constraint::always;
+    if(s == "sometime")
+      return constraint::sometime;
+    if(s == "at-most-once")
+      return constraint::at_most_once;
+    if(s == "sometime-before")
+      return constraint::sometime_before;
+    if(s == "sometime-after")
+      return constraint::sometime_after;
+    throw error{"unknown constraint: " + s};
+  }
+
+  std::string solve(workspace &w, std::vector<std::string> const& lines) {
+    black::alphabet &sigma = *w.sigma;
+
+    problem p = {&sigma, {}, {}, sigma.top(), sigma.top()};
+    std::optional<solver::clock::time_point> deadline;
+    std::unordered_map<identifier, std::string> objects;
+    bool has_goal = false;
+
+    for(std::string const& line : lines) {
+      auto [key, rest] = keyword(line);
+
+      if(key.empty())
+        continue;
+      
+      if(key == "objects") {
+        std::vector<std::string> args = words(rest);
+        if(args.empty())
+          throw error{"missing sort of objects"};
+
+        std::vector<logic::variable> elements;
+        for(size_t i = 1; i < args.size(); ++i) {
+          logic::variable x = sigma.variable(args[i]);
+          elements.push_back(x);
+          objects.insert({x.name(), args[i]});
+        }
+        p.types.push_back(sigma.sort_decl(
+          sort_of(sigma, args[0]), black::make_domain(elements)
+        ));
+        continue;
+      }
+
+      if(key == "init") {
+        literal l = parse_literal(sigma, rest);
+        if(!l.positive)
+          throw error{"initial facts must be positive: " + rest};
+        if(l.atom)
+          p.init.predicates.push_back(*l.atom);
+        else
+          p.init.fluents.push_back(*l.fluent);
+        continue;
+      }
+
+      if(key == "goal") {
+        p.goal = parse_formula(sigma, rest);
+        has_goal = true;
+        continue;
+      }
+
+      if(key == "trajectory") {
+        p.trajectory = parse_temporal(sigma, rest);
+        continue;
+      }
+
+      if(key == "constraint") {
+        auto [name, args] = keyword(rest);
+        size_t sep = args.find(';');
+        if(sep == std::string::npos)
+          p.constraints.push_back({kind(name), parse_formula(sigma, args)});
+        else
+          p.constraints.push_back({
+            kind(name), 
+            parse_formula(sigma, args.substr(0, sep)),
+            parse_formula(sigma, args.substr(sep + 1))
+          });
+        continue;
+      }
+
+      if(key == "deadline") {
+        try {
+          deadline = 
+            solver::clock::now() + std::chrono::milliseconds{std::stoul(rest)};
+        } catch(std::exception const&) {
+          throw error{"invalid deadline: " + rest};
+        }
+        continue;
+      }
+
+      throw error{"unknown problem declaration: " + key};
+    }
+
+    if(!has_goal)
+      throw error{"missing goal"};
+
+    for(logic::named_sort s : w.domain.types) {
+      bool declared = std::any_of(p.types.begin(), p.types.end(), 
+        [&](logic::sort_decl decl) { return decl.sort() == s; }
+      );
+      if(!declared)
+        throw error{"missing objects for some sort of the domain"};
+    }
+
+    w.solver.set_deadline(deadline);
+    tribool result = 
+      w.warm ? w.solver.replan(p) : w.solver.solve(w.domain, p);
+    w.warm = true;
+
+    if(result != true) {
+      w.solver.clear();
+      return result == false ? "unsat\n" : "unknown\n";
+    }
+
+    size_t n = 0;
+    std::string steps;
+    w.solver.for_each_step([&](compact_plan::step step) {
+      steps += w.actions[step.action];
+      if(!step.args.empty()) {
+        steps += "(";
+        for(size_t i = 0; i < step.args.size(); ++i) {
+          if(i > 0)
+            steps += ", ";
+          steps += objects.at(step.args[i].name());
+        }
+        steps += ")";
+      }
+      steps += "\n";
+      n++;
+    });
+    w.solver.clear();
+
+    return "plan " + std::to_string(n) + "\n" + steps;
+  }
+
+  std::string handle(registry &r, std::vector<std::string> const& request) {
+    if(request.empty())
+      return "error empty request\n";
+
+    auto [key, name] = keyword(request.front());
+    std::vector<std::string> lines(request.begin() + 1, request.end());
+
+    try {
+      if(key == "domain") {
+        r.insert(name, parse_domain(lines));
+        return "ok\n";
+      }
+
+      if(key == "problem") {
+        std::shared_ptr<workspace> w = r.find(name);
+        if(!w)
+          return "error unknown domain: " + name + "\n";
+        
+        std::lock_guard lock{w->mutex};
+        return solve(*w, lines);
+      }
+    } catch(error const& e) {
+      return "error "s + e.what() + "\n";
+    } catch(std::exception const& e) {
+      // anything else, e.g. from BLACK, must not take the server down
+      return "error internal error: "s + e.what() + "\n";
+    } catch(...) {
+      return "error internal error\n";
+    }
+
+    return "error unknown request: " + key + "\n";
+  }
+
+}
@@ -0,0 +1,98 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PURPLE_SERVER_PROTOCOL_HPP
+#define PURPLE_SERVER_PROTOCOL_HPP
+
+#include <purple/problem.hpp>
+#include <purple/solver.hpp>
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//
+// Wire format of purple-server. Each request is a sequence of lines, the 
+// first of which names the request, terminated by a line containing `end`.
+// Formulas use the syntax of BLACK.
+//
+//   domain <name>                      problem <domain name>
+//   sort <sort>...                     objects <sort> <object>...
+//   fluent <fluent>...                 init <atom or fluent>
+//   predicate <name> <sort>...         goal <formula>
+//   action <name> <var>:<sort>...      trajectory <formula>
+//   pre <formula>                      constraint <kind> <formula> [;<formula>]
+//   effect <literal> [if <formula>]    deadline <milliseconds>
+//   end                                end
+//
+// where `pre` and `effect` refer to the last `action`, and <kind> is one of
+// `always`, `sometime`, `at-most-once`, `sometime-before`, `sometime-after`.
+//
+// A `domain` request is answered with `ok`, and a `problem` request with
+// `unsat`, `unknown`, or `plan <n>` followed by the n steps of the plan, one
+// per line, as in `go(kitchen, coridor)`. Malformed requests are answered 
+// with `error <message>`.
+//
+namespace purple::server {
+
+  struct error : std::runtime_error {
+    using std::runtime_error::runtime_error;
+  };
+
+  // a domain loaded by the server, together with its own alphabet and a 
+  // solver holding its encoding. Requests over the same workspace must be 
+  // serialized through `mutex`, since alphabets are not thread-safe.
+  struct workspace {
+    std::mutex mutex;
+    std::unique_ptr<black::alphabet> sigma;
+    purple::domain domain;
+    std::vector<std::string> actions; // action names, to print plans
+    purple::solver solver;
+    bool warm = false; // whether `solver` already encoded `domain`
+  };
+
+  // loaded domains, by name
+  class registry {
+  public:
+    void insert(std::string const& name, std::shared_ptr<workspace> w);
+    std::shared_ptr<workspace> find(std::string const& name);
+
+  private:
+    std::mutex _mutex;
+    std::unordered_map<std::string, std::shared_ptr<workspace>> _domains;
+  };
+
+  // `lines` do not include the first line of the request and the final `end`
+  std::shared_ptr<workspace> 
+  parse_domain(std::vector<std::string> const& lines);
+
+  std::string solve(workspace &w, std::vector<std::string> const& lines);
+
+  // handles a whole request, returning the reply
+  std::string handle(registry &r, std::vector<std::string> const& request);
+}
+
+#endif // PURPLE_SERVER_PROTOCOL_HPP
@@ -0,0 +1,147 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "home.hpp"
+
+#include <functional>
+
+//
+// Each kind of PDDL3 constraint, on the way of the robot to the kitchen: a 
+// case that needs a detour to be satisfied, checked on the rooms visited by
+// the plan, and one that cannot be satisfied.
+//
+
+using visits_t = std::vector<purple::logic::variable>;
+
+static std::vector<size_t> 
+positions(visits_t const& visits, purple::logic::variable room) {
+  std::vector<size_t> result;
+  for(size_t i = 0; i < visits.size(); ++i)
+    if(visits[i].name() == room.name())
+      result.push_back(i);
+  return result;
+}
+
+int main() {
+  using purple::constraint;
+
+  tests::home h;
+
+  struct test_case {
+    std::string name;
+    constraint c;
+    std::function<bool(visits_t const&)> satisfied; // empty if unsat
+  };
+
+  std::vector<test_case> cases = {
+    {
+      "always, sat", 
+      constraint{constraint::always, !h.position(h.toilet)},
+      [&](visits_t const& v) { return positions(v, h.toilet).empty(); }
+    },
+    {
+      "always, unsat", 
+      constraint{constraint::always, h.position(h.balcony)}, {}
+    },
+    {
+      "sometime, sat", 
+      constraint{constraint::sometime, h.position(h.toilet)},
+      [&](visits_t const& v) { return !positions(v, h.toilet).empty(); }
+    },
+    {
+      "sometime, unsat", 
+      constraint{constraint::sometime, h.connected(h.kitchen, h.balcony)}, {}
+    },
+    {
+      "at-most-once, sat", 
+      constraint{constraint::at_most_once, h.position(h.coridor)},
+      [&](visits_t const& v) { 
+        std::vector<size_t> c = positions(v, h.coridor);
+        return c.empty() || c.back() - c.front() + 1 == c.size();
+      }
+    },
+    {
+      "at-most-once, unsat", 
+      constraint{
+        constraint::at_most_once, 
+        h.position(h.balcony) || h.position(h.coridor)
+      }, {}
+    },
+    {
+      "sometime-before, sat", 
+      constraint{
+        constraint::sometime_before, 
+        h.position(h.kitchen), h.position(h.toilet)
+      },
+      [&](visits_t const& v) { 
+        std::vector<size_t> k = positions(v, h.kitchen);
+        std::vector<size_t> t = positions(v, h.toilet);
+        return !t.empty() && t.front() < k.front();
+      }
+    },
+    {
+      "sometime-before, unsat", 
+      constraint{
+        constraint::sometime_before, 
+        h.position(h.coridor), h.position(h.kitchen)
+      }, {}
+    },
+    {
+      "sometime-after, sat", 
+      constraint{
+        constraint::sometime_after, 
+        h.position(h.bedroom), h.position(h.toilet)
+      },
+      [&](visits_t const& v) { 
+        std::vector<size_t> b = positions(v, h.bedroom);
+        std::vector<size_t> t = positions(v, h.toilet);
+        return !t.empty() && t.back() > b.back();
+      }
+    },
+    {
+      "sometime-after, unsat", 
+      constraint{
+        constraint::sometime_after, 
+        h.position(h.kitchen), h.position(h.balcony)
+      }, {}
+    }
+  };
+
+  for(test_case const& t : cases) {
+    purple::problem p = h.problem(h.position(h.kitchen), {t.c});
+    purple::solver slv = tests::solver();
+    purple::tribool result = slv.solve(h.domain, p);
+
+    if(!t.satisfied) {
+      tests::check(result == false, t.name);
+      continue;
+    }
+
+    std::optional<purple::plan> plan = slv.solution();
+    tests::check(
+      result == true && plan && t.satisfied(h.visits(*plan)), t.name
+    );
+  }
+
+  return tests::result();
+}
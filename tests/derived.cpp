@@ -0,0 +1,80 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "home.hpp"
+
+//
+// Derived predicates on the house: the robot is beside a room when it is in
+// a room connected to it, and a goal on that is reached one step before the
+// room itself. A recursive definition of reachability is not stratified, so
+// it makes the solver give up.
+//
+
+namespace logic = purple::logic;
+
+int main() {
+  tests::home h;
+
+  logic::variable x = h.sigma.variable("x");
+  std::vector<logic::var_decl> xs = {x[h.room]};
+
+  purple::predicate beside{h.sigma.relation("beside"), {h.r[h.room]}};
+  purple::derived_predicate besides{
+    beside, black::logic::exists(xs, 
+      h.position(x) && (h.connected(x, h.r) || h.connected(h.r, x))
+    )
+  };
+
+  purple::domain d = h.domain;
+  d.derived = {besides};
+
+  purple::solver slv = tests::solver();
+  purple::tribool result = slv.solve(d, h.problem(beside(h.kitchen)));
+  
+  tests::check(result == true, "goal on a derived predicate");
+  if(auto plan = slv.solution(); plan) {
+    std::vector<logic::variable> visits = h.visits(*plan);
+    tests::check(
+      plan->steps.size() == 2 && visits.back().name() == h.coridor.name(),
+      "plan stops beside the kitchen"
+    );
+  }
+
+  purple::predicate reach{h.sigma.relation("reach"), {h.r[h.room]}};
+  purple::derived_predicate reaches{
+    reach, h.position(h.r) || black::logic::exists(xs, 
+      (h.connected(x, h.r) || h.connected(h.r, x)) && reach(x)
+    )
+  };
+
+  d.derived = {reaches};
+
+  purple::solver recursive = tests::solver();
+  tests::check(
+    recursive.solve(d, h.problem(reach(h.kitchen))) == purple::tribool::undef,
+    "recursive definition not solved"
+  );
+
+  return tests::result();
+}
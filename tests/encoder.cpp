@@ -0,0 +1,74 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+// Counts the memory allocations made to solve the kitchen problem, to check
+// that reusing the encoding of the domain spares allocations.
+//
+
+#include "home.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<size_t> allocations = 0;
+
+void *operator new(std::size_t size) {
+  allocations++;
+  if(void *p = std::malloc(size == 0 ? 1 : size); p)
+    return p;
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *p) noexcept {
+  std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+  std::free(p);
+}
+
+int main() {
+  tests::home h;
+  purple::problem p = h.problem(h.position(h.kitchen));
+  purple::solver slv = tests::solver();
+
+  size_t before = allocations;
+  purple::tribool result = slv.solve(h.domain, p);
+  size_t solve = allocations - before;
+
+  tests::check(result == true, "solve");
+  tests::check(slv.stats().reused > 0, "encoder reuses memoized formulas");
+
+  before = allocations;
+  result = slv.replan(p);
+  size_t replan = allocations - before;
+
+  tests::check(result == true, "replan");
+
+  std::cout << "allocations: solve " << solve << ", replan " << replan << "\n";
+  tests::check(replan < solve, "replan allocates less than solve");
+
+  return tests::result();
+}
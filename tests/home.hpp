@@ -0,0 +1,134 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#ifndef PURPLE_TESTS_HOME_HPP
+#define PURPLE_TESTS_HOME_HPP
+
+#include <purple/problem.hpp>
+#include <purple/solver.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+//
+// The domain of `kitchen.cpp`, shared by the tests: a robot moves between 
+// the rooms of a house, starting from the balcony.
+//
+//   kitchen -- coridor -- toilet
+//                 |
+//              bedroom -- balcony
+//
+namespace tests {
+
+  namespace logic = purple::logic;
+
+  struct home {
+    black::alphabet sigma;
+
+    logic::variable from = sigma.variable("from");
+    logic::variable to = sigma.variable("to");
+    logic::variable r = sigma.variable("r");
+
+    logic::named_sort room = sigma.named_sort("room");
+
+    purple::predicate position{sigma.relation("position"), {r[room]}};
+    purple::predicate connected{
+      sigma.relation("connected"), {from[room], to[room]}
+    };
+
+    purple::action go{
+      "go",
+      {from[room], to[room]},
+      position(from) && (connected(from, to) || connected(to, from)),
+      {{position(from), false}, {position(to)}}
+    };
+
+    purple::domain domain{
+      &sigma, {room}, {}, {position, connected}, {go}
+    };
+
+    logic::variable kitchen = sigma.variable("kitchen");
+    logic::variable toilet = sigma.variable("toilet");
+    logic::variable bedroom = sigma.variable("bedroom");
+    logic::variable coridor = sigma.variable("coridor");
+    logic::variable balcony = sigma.variable("balcony");
+
+    logic::sort_decl rooms = sigma.sort_decl(room, black::make_domain({
+      kitchen, toilet, bedroom, coridor, balcony
+    }));
+
+    purple::state init{{}, {
+      position(balcony),
+      connected(kitchen, coridor),
+      connected(toilet, coridor),
+      connected(bedroom, coridor),
+      connected(bedroom, balcony)
+    }};
+
+    purple::problem problem(
+      logic::formula goal, std::vector<purple::constraint> constraints = {}
+    ) {
+      return purple::problem{
+        &sigma, {rooms}, init, goal, sigma.top(), constraints
+      };
+    }
+
+    // rooms visited by the robot following `p`, starting from the balcony
+    std::vector<logic::variable> visits(purple::plan const& p) const {
+      std::vector<logic::variable> result = {balcony};
+      for(purple::plan::step const& step : p.steps)
+        result.push_back(step.args[1]);
+      return result;
+    }
+  };
+
+  // a solver that gives up after a while, so that failing to prove 
+  // unsatisfiability fails the test instead of hanging it
+  inline purple::solver solver() {
+    purple::solver slv;
+    slv.set_deadline(
+      purple::solver::clock::now() + std::chrono::seconds(60)
+    );
+    return slv;
+  }
+
+  inline size_t &failures() {
+    static size_t count = 0;
+    return count;
+  }
+
+  inline void check(bool condition, std::string const& what) {
+    std::cout << (condition ? "PASS: " : "FAIL: ") << what << "\n";
+    if(!condition)
+      failures()++;
+  }
+
+  inline int result() {
+    return failures() == 0 ? 0 : 1;
+  }
+
+}
+
+#endif // PURPLE_TESTS_HOME_HPP
@@ -0,0 +1,127 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+// Learns the `go;go` macro from a plan to the kitchen, and checks that it 
+// makes the kitchen reachable within two steps, while the plan expanded 
+// from them is a valid plan of three primitive steps.
+//
+
+#include "home.hpp"
+
+#include <purple/macros.hpp>
+
+#include <utility>
+
+namespace logic = purple::logic;
+
+// whether `p` takes the robot from the balcony to the kitchen
+static bool valid(tests::home const& h, purple::plan const& p) {
+  std::vector<std::pair<logic::variable, logic::variable>> edges = {
+    {h.kitchen, h.coridor}, {h.toilet, h.coridor}, 
+    {h.bedroom, h.coridor}, {h.bedroom, h.balcony}
+  };
+  auto connected = [&](logic::variable x, logic::variable y) {
+    for(auto [a, b] : edges)
+      if((a.name() == x.name() && b.name() == y.name()) || 
+         (a.name() == y.name() && b.name() == x.name()))
+        return true;
+    return false;
+  };
+
+  logic::variable at = h.balcony;
+  for(purple::plan::step const& step : p.steps) {
+    if(step.action.name != h.go.name || step.args.size() != 2)
+      return false;
+    if(step.args[0].name() != at.name() || !connected(at, step.args[1]))
+      return false;
+    at = step.args[1];
+  }
+
+  return at.name() == h.kitchen.name();
+}
+
+int main() {
+  tests::home h;
+
+  // at most two steps
+  purple::problem bounded = h.problem(h.position(h.kitchen));
+  bounded.trajectory = wX(wX(wX(h.sigma.bottom())));
+
+  purple::solver primitive = tests::solver();
+  tests::check(
+    primitive.solve(h.domain, bounded) == false, 
+    "no plan in two steps without macros"
+  );
+
+  purple::problem unbounded = h.problem(h.position(h.kitchen));
+  purple::solver learner = tests::solver();
+  tests::check(
+    learner.solve(h.domain, unbounded) == true, "plan to learn from"
+  );
+
+  std::optional<purple::compact_plan> plan = learner.compact_solution();
+  tests::check(plan && plan->steps.size() == 3, "plan of three steps");
+  if(!plan)
+    return tests::result();
+
+  // no macros are composed over a recursive definition
+  logic::variable x = h.sigma.variable("x");
+  purple::predicate reach{h.sigma.relation("reach"), {h.r[h.room]}};
+  purple::domain recursive = h.domain;
+  recursive.derived = {{
+    reach, h.position(h.r) || black::logic::exists(
+      std::vector<logic::var_decl>{x[h.room]}, 
+      h.connected(x, h.r) && reach(x)
+    )
+  }};
+  tests::check(
+    purple::learn_macros(recursive, {*plan}) == 0 && 
+    recursive.macros.empty(),
+    "no macros with recursive derived predicates"
+  );
+  
+  // go(balcony, bedroom); go(bedroom, coridor); go(coridor, kitchen) has 
+  // two occurrences of go(x, y); go(y, z)
+  size_t learned = purple::learn_macros(h.domain, {*plan});
+  tests::check(
+    learned == 1 && h.domain.macros.size() == 1 && 
+    h.domain.macros[0].steps.size() == 2 && 
+    h.domain.macros[0].steps[0].args == std::vector<size_t>{0, 1} &&
+    h.domain.macros[0].steps[1].args == std::vector<size_t>{1, 2},
+    "go;go macro learned"
+  );
+
+  purple::solver slv = tests::solver();
+  tests::check(
+    slv.solve(h.domain, bounded) == true, "plan in two steps with macros"
+  );
+
+  std::optional<purple::plan> expanded = slv.solution();
+  tests::check(
+    expanded && expanded->steps.size() == 3 && valid(h, *expanded),
+    "expanded plan is valid"
+  );
+
+  return tests::result();
+}
@@ -0,0 +1,70 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "home.hpp"
+
+//
+// Anytime cost optimization on the house, where the robot can also jump 
+// from the balcony straight into any room, at a higher cost than walking
+// there. The first plan found is the shortest one, jumping into the kitchen,
+// which must be replaced by the longer but cheaper walk through the bedroom
+// and the coridor.
+//
+
+int main() {
+  tests::home h;
+
+  purple::action jump{
+    "jump",
+    {h.from[h.room], h.to[h.room]},
+    h.position(h.from) && h.from == h.balcony,
+    {{h.position(h.from), false}, {h.position(h.to)}},
+    5
+  };
+
+  purple::domain d{
+    &h.sigma, {h.room}, {}, {h.position, h.connected}, {h.go, jump}
+  };
+
+  std::vector<size_t> costs;
+  std::vector<size_t> lengths;
+  purple::solver slv = tests::solver();
+  purple::tribool result = slv.optimize(
+    d, h.problem(h.position(h.kitchen)), 
+    [&](purple::plan const& p, size_t cost) {
+      costs.push_back(cost);
+      lengths.push_back(p.steps.size());
+    }
+  );
+
+  tests::check(result == true, "last plan proved optimal");
+  tests::check(
+    costs == std::vector<size_t>{5, 3}, "costs of the plans found"
+  );
+  tests::check(
+    lengths == std::vector<size_t>{1, 3}, "cheaper plan is longer"
+  );
+
+  return tests::result();
+}
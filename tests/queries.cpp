@@ -0,0 +1,92 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+
+#include "home.hpp"
+
+//
+// Many goal queries answered over the same encoding of the house, from the
+// balcony: the bedroom is one step away, the coridor two and the kitchen 
+// and the toilet three.
+//
+
+namespace logic = purple::logic;
+namespace temporal = purple::temporal;
+
+// whether `a` is a plan of `length` steps ending in `room`
+static bool reaches(
+  tests::home const& h, purple::solver::answer const& a, 
+  logic::variable room, size_t length
+) {
+  if(a.result != true || !a.solution)
+    return false;
+  
+  std::vector<logic::variable> visits = h.visits(*a.solution);
+  return a.solution->steps.size() == length && 
+    visits.back().name() == room.name();
+}
+
+int main() {
+  tests::home h;
+
+  // at most two steps
+  temporal::formula short_trip = wX(wX(wX(h.sigma.bottom())));
+  temporal::formula any_trip = h.sigma.top();
+
+  purple::solver slv = tests::solver();
+  std::vector<purple::solver::answer> answers = slv.solve(
+    h.domain, h.problem(h.sigma.top()), {
+      {h.position(h.bedroom), any_trip},
+      {h.position(h.kitchen), short_trip},
+      {h.position(h.toilet), short_trip}
+    }
+  );
+
+  tests::check(answers.size() == 3, "one answer per query");
+  if(answers.size() == 3) {
+    tests::check(reaches(h, answers[0], h.bedroom, 1), "reachable query");
+    tests::check(answers[1].result == false, "unreachable query");
+    tests::check(
+      answers[2].result == false, "unreachable query answered with the other"
+    );
+  }
+
+  // the kitchen and the toilet are interchangeable in both rounds
+  answers = slv.solve(
+    h.domain, h.problem(h.sigma.top()), {
+      {h.position(h.coridor), any_trip},
+      {h.position(h.bedroom), any_trip}
+    }
+  );
+
+  tests::check(answers.size() == 2, "one answer per query");
+  if(answers.size() == 2) {
+    tests::check(reaches(h, answers[0], h.coridor, 2), "two-step query");
+    tests::check(reaches(h, answers[1], h.bedroom, 1), "one-step query");
+  }
+  tests::check(
+    slv.stats().symmetric == 1, "symmetries counted for the last round only"
+  );
+
+  return tests::result();
+}
@@ -0,0 +1,203 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+//
+// Starts the purple-server executable given on the command line on a 
+// temporary socket, and checks its replies on the kitchen domain.
+//
+
+#include "home.hpp"
+
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <thread>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static std::string const domain = R"(domain home
+sort room
+predicate position room
+predicate connected room room
+action go from:room to:room
+pre position(from) & (connected(from, to) | connected(to, from))
+effect !position(from)
+effect position(to)
+end
+)";
+
+static std::string problem(std::string const& extra) {
+  return 
+    "problem home\n"
+    "objects room kitchen toilet bedroom coridor balcony\n"
+    "init position(balcony)\n"
+    "init connected(kitchen, coridor)\n"
+    "init connected(toilet, coridor)\n"
+    "init connected(bedroom, coridor)\n"
+    "init connected(bedroom, balcony)\n" + extra + "end\n";
+}
+
+class client {
+public:
+  explicit client(int fd) : _fd{fd} { }
+  ~client() { close(_fd); }
+
+  client(client const&) = delete;
+  client &operator=(client const&) = delete;
+
+  // sends `request` and returns the whole reply
+  std::string request(std::string const& text) {
+    if(::write(_fd, text.data(), text.size()) != ssize_t(text.size()))
+      return "";
+
+    std::string reply = line();
+    if(reply.rfind("plan ", 0) == 0) {
+      size_t n = std::stoul(reply.substr(5));
+      for(size_t i = 0; i < n; ++i)
+        reply += "\n" + line();
+    }
+    return reply;
+  }
+
+private:
+  std::string line() {
+    while(true) {
+      size_t newline = _buffer.find('\n');
+      if(newline != std::string::npos) {
+        std::string result = _buffer.substr(0, newline);
+        _buffer.erase(0, newline + 1);
+        return result;
+      }
+
+      char chunk[4096];
+      ssize_t n = ::read(_fd, chunk, sizeof(chunk));
+      if(n <= 0)
+        return "";
+      _buffer.append(chunk, size_t(n));
+    }
+  }
+
+  int _fd;
+  std::string _buffer;
+};
+
+// connects to the server, waiting for it to start listening
+static std::optional<int> connect_to(std::string const& path) {
+  sockaddr_un addr{};
+  addr.sun_family = AF_UNIX;
+  std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+  for(int attempt = 0; attempt < 100; ++attempt) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0)
+      return {};
+    if(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0)
+      return fd;
+    close(fd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+  return {};
+}
+
+int main(int argc, char **argv) {
+  if(argc != 2) {
+    std::cerr << "Usage: " << argv[0] << " <path of purple-server>\n";
+    return 1;
+  }
+
+  char dir[] = "/tmp/purple-test-XXXXXX";
+  if(!mkdtemp(dir)) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  std::string path = std::string{dir} + "/socket";
+
+  pid_t server = fork();
+  if(server < 0) {
+    std::perror("fork");
+    return 1;
+  }
+  if(server == 0) {
+    execl(argv[1], argv[1], path.c_str(), static_cast<char *>(nullptr));
+    std::perror("execl");
+    std::_Exit(1);
+  }
+
+  if(auto fd = connect_to(path); fd) {
+    client c{*fd};
+
+    tests::check(c.request(domain) == "ok", "domain is loaded");
+
+    tests::check(
+      c.request(problem("goal position(kitchen)\n")) == 
+        "plan 3\n"
+        "go(balcony, bedroom)\n"
+        "go(bedroom, coridor)\n"
+        "go(coridor, kitchen)",
+      "plan to the kitchen"
+    );
+
+    tests::check(
+      c.request(problem("goal connected(kitchen, balcony)\n")) == "unsat",
+      "unreachable goal"
+    );
+
+    tests::check(
+      c.request(problem("goal position(kitchen)\ndeadline 0\n")) == 
+        "unknown",
+      "expired deadline"
+    );
+
+    tests::check(
+      c.request("problem nowhere\ngoal position(kitchen)\nend\n") == 
+        "error unknown domain: nowhere",
+      "unknown domain"
+    );
+
+    tests::check(
+      c.request("domain broken\naction\nend\n") == 
+        "error missing action name",
+      "malformed domain"
+    );
+
+    tests::check(
+      c.request(problem("goal position(kitchen)\n")).rfind("plan 3\n", 0) 
+        == 0,
+      "plan after an expired deadline"
+    );
+  } else {
+    tests::check(false, "connection to the server");
+  }
+
+  kill(server, SIGTERM);
+  waitpid(server, nullptr, 0);
+  unlink(path.c_str());
+  rmdir(dir);
+
+  return tests::result();
+}
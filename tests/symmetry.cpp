@@ -0,0 +1,122 @@
+// 
+// PURPLE - Expressive Automated Planner based on BLACK
+// 
+// (C) 2022 Nicola Gigante
+// 
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "home.hpp"
+
+#include <optional>
+
+//
+// Symmetry detection on a house where the robot starts from the coridor, 
+// and the kitchen, the toilet and the bedroom are only connected to it, so 
+// that they are interchangeable unless something tells them apart.
+//
+
+namespace logic = purple::logic;
+
+static void test(
+  tests::home const& h, std::string const& name, purple::domain const& d,
+  purple::problem const& p, size_t excluded, 
+  std::optional<logic::variable> first = {}
+) {
+  purple::solver slv = tests::solver();
+  purple::tribool result = slv.solve(d, p);
+
+  tests::check(result == true, name + ", solvable");
+  tests::check(
+    slv.stats().symmetric == excluded, 
+    name + ", " + std::to_string(excluded) + " objects excluded"
+  );
+  
+  // a single move from the coridor suffices in all the cases
+  auto plan = slv.solution();
+  if(!plan)
+    return;
+
+  tests::check(
+    plan->steps.size() == 1 && 
+    plan->steps[0].args[0].name() == h.coridor.name(), 
+    name + ", plan"
+  );
+
+  if(first && plan->steps.size() == 1)
+    tests::check(
+      plan->steps[0].args[1].name() == first->name(),
+      name + ", first move pruned"
+    );
+}
+
+int main() {
+  tests::home h;
+
+  purple::state init{{}, {
+    h.position(h.coridor),
+    h.connected(h.kitchen, h.coridor),
+    h.connected(h.toilet, h.coridor),
+    h.connected(h.bedroom, h.coridor)
+  }};
+
+  // leave the coridor for any room but the balcony
+  logic::formula away = black::logic::exists(
+    std::vector<logic::var_decl>{h.r[h.room]},
+    h.position(h.r) && h.r != h.coridor && h.r != h.balcony
+  );
+
+  test(h, "interchangeable rooms", h.domain, 
+    purple::problem{&h.sigma, {h.rooms}, init, away, h.sigma.top()}, 2,
+    h.kitchen // the toilet and the bedroom would do as well without pruning
+  );
+
+  test(h, "room mentioned in the goal", h.domain,
+    purple::problem{
+      &h.sigma, {h.rooms}, init, h.position(h.kitchen), h.sigma.top()
+    }, 1
+  );
+
+  logic::named_sort place = h.sigma.named_sort("place");
+  logic::sort_decl places = h.sigma.sort_decl(place, black::make_domain({
+    h.kitchen, h.toilet, h.bedroom
+  }));
+
+  test(h, "rooms declared in two sorts", h.domain,
+    purple::problem{&h.sigma, {h.rooms, places}, init, away, h.sigma.top()}, 0
+  );
+
+  logic::variable n = h.sigma.variable("n");
+  purple::predicate level{
+    h.sigma.relation("level"), {h.r[h.room], n[h.sigma.integer_sort()]}
+  };
+  purple::domain leveled{
+    &h.sigma, {h.room}, {}, {h.position, h.connected, level}, {h.go}
+  };
+
+  purple::state numbered = init;
+  numbered.predicates.push_back(level(h.kitchen, h.sigma.integer(0)));
+  numbered.predicates.push_back(level(h.toilet, h.sigma.integer(0)));
+  numbered.predicates.push_back(level(h.bedroom, h.sigma.integer(0)));
+
+  test(h, "non-variable terms in the initial state", leveled,
+    purple::problem{&h.sigma, {h.rooms}, numbered, away, h.sigma.top()}, 0
+  );
+
+  return tests::result();
+}